@@ -7,6 +7,7 @@ cp -r $ORIGIN_SIM_PATH $BUILD_SIM_PATH
 
 cp ./src/cpu/* $BUILD_SIM_PATH/CPU/
 cp ./src/Makefile $BUILD_SIM_PATH/spim/
+cp ./src/spim.c $BUILD_SIM_PATH/spim/
 
 cd $BUILD_SIM_PATH/spim
 make
@@ -0,0 +1,169 @@
+
+#ifndef __cache_model__
+#define __cache_model__
+
+/* Data structures of the cache model shared by cache.c and the analyses
+   built on top of it. */
+
+#include "tag-match.h"
+#include "replacement.h"
+#include "opt.h"
+#include "mshr.h"
+#include "prefetch.h"
+#include "write-buffer.h"
+#include "stack-distance.h"
+#include "set-sampling.h"
+#include "pc-profile.h"
+#include "miss-class.h"
+
+typedef enum WritePolicy {
+	WT, WB,
+} WritePolicy;
+
+typedef int Data;
+
+#define CACHE_LINE_SIZE 64
+
+#define IGNORED_REFERENCES 7	// the exported interface does not simulate the first references
+
+#define LINE_DIRTY 0x1
+#define LINE_PREFETCHED 0x2	// filled by a prefetch and not used yet
+
+typedef struct CacheConfig {
+	int size;
+	int numberOfEntries;
+	int numberOfWay;
+	ReplacementPolicy replacementPolicy;
+	WritePolicy writePolicy;
+	int cacheHitTime;
+	int numberOfMSHR;
+	int writeBufferSize;
+	PrefetcherKind prefetcher;
+	int prefetchDegree;
+	char* missRatioCurveFile;
+	bool classifyMisses;
+	bool keepData;
+} CacheConfig;
+
+/* Per-set fill state. Lines are never invalidated, so a set fills its ways
+   in order and the first invalid way is validCount. The lines themselves
+   live in the tag store, the replacement state in ReplacementState. */
+typedef struct WaySet {
+	int validCount;
+} WaySet;
+
+/* Tag store of a cache. All per-line state is kept in parallel arrays
+   indexed by set * numberOfWay + way, carved out of one cache-line-aligned
+   allocation so that a set lookup touches consecutive memory only.
+   The valid bit is folded into the tag word (see tag-match.h) so a whole
+   set can be compared against one key.
+   The line payload is only allocated when the level is configured with
+   DATA; otherwise data is NULL and a line costs 5 bytes. */
+typedef struct TagStore {
+	unsigned int* tags;
+	unsigned char* flags;
+	Data* data;
+	int lengthOfData;
+	void* memory;
+} TagStore;
+
+typedef struct Result {
+	long long accessCount;
+	long long hitCount;
+} Result;
+
+/* lastHits holds for every set the tag word of the line that was hit last
+   by access, or 0 once another access or a fill has touched the set since.
+   A hit on that line again leaves the replacement state as it is under
+   every policy, so loadCache only counts it. */
+typedef struct Cache {
+	char name[20];
+	CacheConfig config;
+	WaySet* entries;
+	TagStore lines;
+	ReplacementState replacement;
+	int tagSize;
+	int indexSize;
+	int blockOffsetSize;
+	int indexShift;
+	int tagShift;
+	TagMatchFunction matchTag;
+	unsigned int* lastHits;
+	Result result;
+	OptTrace* optTrace;
+	MSHRFile mshr;
+	Prefetcher* prefetcher;
+	WriteBuffer* writeBuffer;
+	StackDistance* stackDistance;
+	SampleCounts* sampleCounts;
+	PCProfile* pcProfile;
+	MissClassifier* missClassifier;
+	Cache* nextLevelCache;
+} Cache;
+
+/* One level of the hierarchy. A split level has separate instruction and
+   data caches; in a unified level both point at the same cache. */
+typedef struct CacheLevel {
+	CacheConfig config;
+	bool split;
+	Cache* instructionCache;
+	Cache* dataCache;
+} CacheLevel;
+
+/* The hierarchy is a tree: instruction fetches enter at the L1 instruction
+   cache and data accesses at the L1 data cache, and every cache passes its
+   misses on to nextLevelCache (memory after the last level).
+   clock estimates the current cycle for the blocking interface: one cycle
+   per fetched instruction plus the stall cycles returned so far, which
+   are also summed up in stallCycles.
+   sample is set when only some sets are simulated (SAMPLE).
+   profileTop is the number of PCs reported per cache with PROFILE, or 0. */
+typedef struct CacheSystem {
+	Cache* L1InstructionCache;
+	Cache* L1DataCache;
+	CacheLevel* levels;
+	int numberOfLevels;
+	int memoryAccessTime;
+	bool computeOpt;
+	int sampleRatio;
+	SetSample* sample;
+	int profileTop;
+	long long clock;
+	long long stallCycles;
+} CacheSystem;
+
+extern __thread CacheSystem cacheSystem;
+
+void createCacheSystem();
+Cache* createCache(CacheConfig cacheConfig);
+int change(Cache* cache, unsigned int addr);
+int insert(Cache* cache, int index, unsigned int tag, unsigned int addr);
+bool access(Cache* cache, int index, unsigned int tag);
+int loadCache(Cache* cache, unsigned int addr, unsigned int pc);
+long long loadCacheAt(Cache* cache, unsigned int addr, unsigned int pc, long long now);
+int loadInstCache(unsigned int addr);
+int loadDataCache(unsigned int addr, unsigned int pc);
+int storeDataCache(unsigned int addr);
+Result estimatedResult(Cache* cache);
+Result simulateOpt(Cache* cache);
+
+static inline unsigned int getTag(Cache* cache, unsigned int addr) {
+	return addr >> cache->tagShift;
+}
+
+static inline int getIndex(Cache* cache, unsigned int addr) {
+	return (addr >> cache->indexShift) & (cache->config.numberOfEntries - 1);
+}
+
+/* Returns the way of set index holding tag, or -1 when it is not cached. */
+static inline int findWay(Cache* cache, int index, unsigned int tag) {
+	int numberOfWay = cache->config.numberOfWay;
+	unsigned int* tags = cache->lines.tags + index * numberOfWay;
+
+	if (numberOfWay < 4) {
+		return matchTagScalar(tags, numberOfWay, tag | TAG_VALID);
+	}
+	return cache->matchTag(tags, numberOfWay, tag | TAG_VALID);
+}
+
+#endif
@@ -1,505 +1,1193 @@
-#include "cache.h"
-#include "spim.h"
-#include "run.h"
-
-typedef enum ReplacementPolicy {
-  LRU, FIFO,
-} ReplacementPolicy;
-
-typedef enum WritePolicy {
-	WT, WB,
-} WritePolicy;
-
-typedef int Data;
-
-typedef struct Block {
-	bool valid;
-	bool dirty;
-	int tag;
-	Data* data;
-	int lengthOfData;
-} Block;
-
-typedef struct CacheConfig {
-	int size;
-	int numberOfEntries;
-	int numberOfWay;
-	ReplacementPolicy replacementPolicy;
-	WritePolicy writePolicy;
-	int cacheHitTime;
-} CacheConfig;
-
-typedef struct WaySet {
-	Block* blocks;
-	int* recentlyUsed;
-	int firstInIndex;
-} WaySet;
-
-typedef struct Result {
-	int accessCount;
-	int hitCount;
-} Result;
-
-typedef struct Cache {
-	CacheConfig config;
-	WaySet* entries;
-	int tagSize;
-	int indexSize;
-	int blockOffsetSize;
-	Result result;
-	Cache* nextLevelCache;
-} Cache;
-
-typedef struct CacheSystem {
-	Cache* L1InstructionCache;
-	Cache* L1DataCache;
-	int numberOfLevels;
-	int memoryAccessTime;
-} CacheSystem;
-
-bool isCacheSystemCreated = false;
-int instructionCount = 0;
-CacheSystem cacheSystem;
-
-int getLog(int src) {
-	int i;
-	int count = 0;
-
-	while(src != 1) {
-		src = src >> 1;
-		count += 1;
-	}
-
-	return count;
-}
-
-void printCacheConfig(CacheConfig config) {
-	char* replacementPolicy;
-	char* writePolicy;
-	if (config.replacementPolicy == LRU) {
-		replacementPolicy = "LRU";
-	} else if (config.replacementPolicy == FIFO) {
-		replacementPolicy = "FIFO";
-	}
-	if (config.writePolicy == WT) {
-		writePolicy = "WT";
-	} else if (config.writePolicy == WB) {
-		writePolicy = "WB";
-	}
-	printf("%d %d %d %s %s %d\n", config.size, config.numberOfEntries, config.numberOfWay, replacementPolicy, writePolicy, config.cacheHitTime);
-}
-
-Cache* createCache(CacheConfig cacheConfig) {
-	Cache* cache = (Cache *)malloc(sizeof(Cache));
-	cache->config = cacheConfig;
-
-	int lengthOfData = cacheConfig.size / cacheConfig.numberOfEntries / cacheConfig.numberOfWay / sizeof(Data);
-
-	WaySet* entries = (WaySet *) malloc(sizeof(WaySet) * cacheConfig.numberOfEntries);
-
-	int i, j, k;
-	for (i = 0; i < cacheConfig.numberOfEntries; i++) {
-		Block* blocks = (Block *) malloc(sizeof(Block) * cacheConfig.numberOfWay);
-		int* recentlyUsed = (int *) malloc(sizeof(int) * cacheConfig.numberOfWay);
-
-		for (j = 0; j < cacheConfig.numberOfWay; j++) {
-			Data* data = (Data *) malloc(sizeof(Data) * lengthOfData);
-		
-			for (k = 0; k < lengthOfData; k++) {
-				data[k] = 0;
-			}
-
-			blocks[j].tag = 0;
-			blocks[j].data = data;
-			blocks[j].lengthOfData = lengthOfData;
-			blocks[j].valid = false;
-			blocks[j].dirty = false;
-		}
-
-		for (j = 0; j < cacheConfig.numberOfWay; j++) {
-			recentlyUsed[j] = 0;
-		}
-
-		entries[i].blocks = blocks;
-		entries[i].recentlyUsed = recentlyUsed;
-		entries[i].firstInIndex = 0;
-	}
-
-	cache->blockOffsetSize = getLog(lengthOfData);
-	cache->indexSize = getLog(cacheConfig.numberOfEntries);
-	cache->result.accessCount = 0;
-	cache->result.hitCount = 0;
-	cache->entries = entries;
-	cache->nextLevelCache = NULL;
-
-	return cache;
-}
-
-void loadCacheConfig(int* numberOfLevels, int* memoryAccessTime, CacheConfig* l1CacheConfig, CacheConfig* l2CacheConfig) {
-	int i;
-	char buffer[100];
-	FILE* file = fopen("../CPU/cache.config", "r");
-
-	if(file == NULL){
-    printf("파일열기 실패\n");
-		return;
-  }
-
-	fgets(buffer, sizeof(buffer), file);
-	char* temp = strtok(buffer, " ");
-	*numberOfLevels = atoi(temp);
-	temp = strtok(NULL, " ");
-	*memoryAccessTime = atoi(temp);
-
-	for (i = 0; i < *numberOfLevels; i++) {
-		CacheConfig* c;
-		if (i == 0) {
-			c = l1CacheConfig;
-		} else {
-			c = l2CacheConfig;
-		}
-		fgets(buffer, sizeof(buffer), file);
-		temp = strtok(buffer, " ");
-		c->size = atoi(temp);
-		temp = strtok(NULL, " ");
-		c->numberOfEntries = atoi(temp);
-		temp = strtok(NULL, " ");
-		c->numberOfWay = atoi(temp);
-		temp = strtok(NULL, " ");
-		if (strcmp(temp, "FIFO") == 0) {
-			c->replacementPolicy = FIFO;
-		} else if (strcmp(temp, "LRU") == 0) {
-			c->replacementPolicy = LRU;
-		}
-		temp = strtok(NULL, " ");
-		if (strcmp(temp, "WT") == 0) {
-			c->writePolicy = WT;
-		} else if (strcmp(temp, "WB") == 0) {
-			c->writePolicy = WB;
-		}
-		temp = strtok(NULL, " ");
-		if (i == 0) {
-			c->cacheHitTime = 0;
-		} else {
-			c->cacheHitTime = atoi(temp);
-		}
-	}
-
-}
-
-void createCacheSystem() {
-	CacheConfig l1CacheConfig, l2CacheConfig;
-	int numberOfLevels, memoryAccessTime;
-
-	loadCacheConfig(&numberOfLevels, &memoryAccessTime, &l1CacheConfig, &l2CacheConfig);
-
-	// printCacheConfig(l1CacheConfig);
-	// printCacheConfig(l2CacheConfig);
-
-	Cache* L1DataCache = NULL;
-	Cache* L1InstructionCache = NULL;
-	Cache* L2Cache = NULL;
-
-	cacheSystem.L1DataCache = createCache(l1CacheConfig);
-	cacheSystem.L1InstructionCache = createCache(l1CacheConfig);
-
-	if (numberOfLevels == 2) {
-		L2Cache = createCache(l2CacheConfig);
-	}
-	cacheSystem.numberOfLevels = numberOfLevels;
-	cacheSystem.memoryAccessTime = memoryAccessTime;
-	cacheSystem.L1DataCache->nextLevelCache = L2Cache;
-	cacheSystem.L1InstructionCache->nextLevelCache = L2Cache;
-
-	isCacheSystemCreated = true;
-}
-
-void printCache(Cache* cache) {
-	int i, j, k;
-	for (i = 0; i < cache->config.numberOfEntries; i++) {
-		WaySet waySet = cache->entries[i];
-		printf(" [%d] ||", i);
-		for (j = 0; j < cache->config.numberOfWay; j++) {
-			Block block = waySet.blocks[j];
-			printf(" (%d) (%d) (0x%x) ", block.valid, block.dirty, block.tag);
-			for (k = 0; k < block.lengthOfData; k++) {
-				printf(" %d ", block.data[k]);
-			}
-			printf("|");
-		}
-		printf("\n");
-	}
-}
-
-void printCacheSystem() {
-	printf("\nLevel 1 Instruction Cache\n");
-	printCache(cacheSystem.L1InstructionCache);
-	
-	printf("Level 1 Data Cache\n");
-	printCache(cacheSystem.L1DataCache);
-
-	if (cacheSystem.numberOfLevels == 2) {
-		printf("Level 2 Data Cache\n");
-		printCache(cacheSystem.L1DataCache->nextLevelCache);
-	} 
-
-	printf("-------------------------------\n");
-}
-
-int getTag(Cache cache, unsigned int addr) {
-	return addr >> (2 + cache.blockOffsetSize + cache.indexSize);
-}
-
-int getIndex(Cache cache, unsigned int addr) {
-	return (addr >> (2 + cache.blockOffsetSize)) & (cache.config.numberOfEntries - 1);
-}
-
-int change(Cache* cache, unsigned int addr) {
-	int i;
-	int stallCycles = cache->config.cacheHitTime;
-	int index = getIndex(*cache, addr);
-	int tag = getTag(*cache, addr);
-
-	if (cache->config.writePolicy == WT) {
-		if (cache->nextLevelCache == NULL) {
-			stallCycles += cacheSystem.memoryAccessTime;
-		} else {
-			stallCycles += change(cache->nextLevelCache, addr);
-		}
-		// printf(" (change WT) ");
-	} else if (cache->config.writePolicy == WB) {
-		for (i = 0; i < cache->config.numberOfWay; i++) {
-			if (cache->entries[index].blocks[i].tag == tag) {
-				cache->entries[index].blocks[i].dirty = true;
-				// printf(" (change WB) " );
-			}
-		}
-	}
-
-	return stallCycles;
-}
-
-int insert(Cache* cache, int index, int tag, unsigned int addr) {
-	int blockPlace, i;
-	int stallCycles = 0;
-
-	WaySet waySet = cache->entries[index];
-
-	for (blockPlace = 0; blockPlace < cache->config.numberOfWay; blockPlace++) {
-		if (waySet.blocks[blockPlace].valid == false) break;
-	}
-
-	if (blockPlace == cache->config.numberOfWay) {
-		if (cache->config.replacementPolicy == LRU) {
-			int leastUsed = waySet.recentlyUsed[0];
-			blockPlace = 0;
-			for (i = 0; i < cache->config.numberOfWay; i++) {
-				if (waySet.recentlyUsed[i] < leastUsed) {
-					blockPlace = i;
-					leastUsed = waySet.recentlyUsed[i];
-				}
-			}
-			// printf(" (replace LRU %dth block) ", blockPlace);
-		} else if (cache->config.replacementPolicy == FIFO) {
-			blockPlace = waySet.firstInIndex;
-			cache->entries[index].firstInIndex = (waySet.firstInIndex == cache->config.numberOfWay)
-				? 0
-				: waySet.firstInIndex + 1;
-			// printf(" (replace FIFO %dth block) ", blockPlace);
-		}
-	}
-
-	if (waySet.blocks[blockPlace].dirty) {
-		if (cache->nextLevelCache == NULL) {
-			stallCycles += cacheSystem.memoryAccessTime;
-		} else {
-			stallCycles += change(cache->nextLevelCache, addr);
-		}
-	}
-
-	cache->entries[index].blocks[blockPlace].tag = tag;
-	cache->entries[index].blocks[blockPlace].valid = true;
-	cache->entries[index].blocks[blockPlace].dirty = false;
-	// printf(" (insert %x, %x, %d, %d) ", index, tag, blockPlace, instructionCount);
-	return stallCycles;
-}
-
-bool access(Cache* cache, int index, int tag) {
-	int i;
-	int stallCycle = cache->config.cacheHitTime;
-
-	cache->result.accessCount += 1;
-	for (i = 0; i < cache->config.numberOfWay; i++) {
-		Block block = cache->entries[index].blocks[i];
-
-		if (block.tag == tag) {
-			cache->result.hitCount += 1;
-			cache->entries[index].recentlyUsed[i] = cache->result.accessCount;
-			// printf(" (hit!!) ");
-			return true;
-		}
-	}
-	// printf(" (missㅠㅠ) ");
-	return false;
-}
-
-int loadCache(Cache* cache, unsigned int addr) {
-	int stallCycle = cache->config.cacheHitTime;
-	int index = getIndex(*cache, addr);
-	int tag = getTag(*cache, addr);
-
-	if (!access(cache, index, tag)) {
-		if (cache->nextLevelCache == NULL) {
-			stallCycle += cacheSystem.memoryAccessTime;
-		} else {
-			stallCycle += loadCache(cache->nextLevelCache, addr);
-		}
-		stallCycle += insert(cache, index, tag, addr);
-	}
-
-	return stallCycle;
-}
-
-int loadInstCache(unsigned int addr) {
-	return loadCache(cacheSystem.L1InstructionCache, addr);
-}
-
-int loadDataCache(unsigned int addr) {
-	return loadCache(cacheSystem.L1DataCache, addr);
-}
-
-int storeDataCache(unsigned int addr) {
-	return change(cacheSystem.L1DataCache, addr);
-}
-
-int data_load (unsigned int addr) {
-	/* You have to implement your own data_load function here! */
-	int stallCycles = 0;
-	instructionCount += 1;
-	if (instructionCount < 8) return 0;
-
-	if (!isCacheSystemCreated) {
-		createCacheSystem();
-	}
-
-	stallCycles += loadDataCache(addr);
-
-	// printf("\nLOAD DATA - 0x%x (%d)\n", addr, stallCycles);
-	// printCacheSystem();
-
-	return stallCycles;
-	// Return value: stall cycles due to L1 cache miss
-	///////////////////////////////////////////////////////////
-}
-
-int instruction_load (unsigned int addr) {
-	/* You have to implement your own instruction_load function here! */
-	int stallCycles = 0;
-	instructionCount += 1;
-	if (instructionCount < 8) return 0;
-	
-	if (!isCacheSystemCreated) {
-		createCacheSystem();
-	}
-
-	stallCycles += loadInstCache(addr);
-
-	// printf("\nLOAD INST - 0x%x (%d)\n", addr, stallCycles);
-	// printCacheSystem();
-
-	return stallCycles;
-	// Return value: stall cycles due to L1 cache miss 
-	///////////////////////////////////////////////////////////
-}
-
-int data_store(unsigned int addr) {
-	/* You have to implement your own data_store function here! */
-	int stallCycles = 0;
-	instructionCount += 1;
-	if (instructionCount < 8) return 0;
-
-	if (!isCacheSystemCreated) {
-		createCacheSystem();
-	}
-
-	stallCycles += loadDataCache(addr);
-	stallCycles += storeDataCache(addr);
-	
-	// printf("\nSTORE DATA - 0x%x (%d)\n", addr, stallCycles);
-	// printCacheSystem();
-
-	return stallCycles;
-	// Return value: stall cycles due to L1 cache miss
-	///////////////////////////////////////////////////////////
-}
-
-void print_cache_result(int n_cycles) {
-	/* You have to print the result of hit/miss count of each cache. You have to follow the format as below example.
-	Calculate hit ratio down to three places of decimals.
-	Example)
-	Level 1 Cache
-	Hit Count of l1i-cache: 4
-	Miss Count of l1i-cache: 5
-	Hit Ratio of l1i-cache: 0.444
-
-	Hit Count of l1d-cache: 1
-	Miss Count of l1d-cache: 3
-	Hit Ratio of l1d-cache: 0.250
-
-	Level 2 Cache
-	Hit Count: 0
-	Miss Count: 8
-	Hit Ratio: 0.000
-
-	Total Hit Ratio: 0.385
-	*/
-
-	/* You have to implement your own print_cache_result function here! */
-	float l2HitRate;
-	instructionCount += 1;
-
-	if (!isCacheSystemCreated) {
-		createCacheSystem();
-	}
-	float l1iAccessCount = cacheSystem.L1InstructionCache->result.accessCount;
-	float l1iHitCount = cacheSystem.L1InstructionCache->result.hitCount;
-	float l1iHitRate = l1iHitCount / l1iAccessCount;
-
-	float l1dAccessCount = cacheSystem.L1DataCache->result.accessCount;
-	float l1dHitCount = cacheSystem.L1DataCache->result.hitCount;
-	float l1dHitRate = l1dHitCount / l1dAccessCount;
-
-	if (cacheSystem.numberOfLevels == 2) {
-		float l2AccessCount = cacheSystem.L1DataCache->nextLevelCache->result.accessCount;
-		float l2HitCount = cacheSystem.L1DataCache->nextLevelCache->result.hitCount;
-		l2HitRate = l2HitCount / l2AccessCount;
-	}
-
-	float totalAccessCount = cacheSystem.L1InstructionCache->result.accessCount + cacheSystem.L1DataCache->result.accessCount;
-	float totalHitCount = cacheSystem.L1InstructionCache->result.hitCount + cacheSystem.L1DataCache->result.hitCount;
-	if (cacheSystem.numberOfLevels == 2) {
-		totalHitCount += cacheSystem.L1DataCache->nextLevelCache->result.hitCount;
-	}
-	float totalHitRate = totalHitCount / totalAccessCount;
-
-	printf("\n");
-	printf("Level 1 Cache\n");
-	printf("Hit Count of l1i-cache: %d\n", cacheSystem.L1InstructionCache->result.hitCount);
-	printf("Miss Count of l1i-cache: %d\n", cacheSystem.L1InstructionCache->result.accessCount - cacheSystem.L1InstructionCache->result.hitCount);
-	printf("Hit Ratio of l1i-cache: %0.3f\n", l1iHitRate);
-	printf("\n");
-	printf("Hit Count of l1d-cache: %d\n", cacheSystem.L1DataCache->result.hitCount);
-	printf("Miss Count of l1d-cache: %d\n", cacheSystem.L1DataCache->result.accessCount - cacheSystem.L1DataCache->result.hitCount);
-	printf("Hit Ratio of l1d-cache: %0.3f\n", l1dHitRate);
-	printf("\n");
-	printf("Level 2 Cache\n");
-	if (cacheSystem.numberOfLevels == 2) {
-		printf("Hit Count: %d\n", cacheSystem.L1DataCache->nextLevelCache->result.hitCount);
-		printf("Miss Count: %d\n", cacheSystem.L1DataCache->nextLevelCache->result.accessCount - cacheSystem.L1DataCache->nextLevelCache->result.hitCount);
-		printf("Hit Ratio: %0.3f\n", l2HitRate);
-	}
-	printf("\n");
-	printf("Total Hit Ratio: %0.3f\n", totalHitRate);
-
-	//////////////////////////////////////////////////////////////////////
-}
+#include "cache.h"
+#include "spim.h"
+#include "run.h"
+#include "cache-model.h"
+
+// per thread, so that cachesweep can simulate one hierarchy per worker
+__thread bool isCacheSystemCreated = false;
+__thread char* cacheConfigFile = "../CPU/cache.config";
+__thread int instructionCount = 0;
+__thread CacheSystem cacheSystem;
+
+static PCDescriber pcDescriber = NULL;
+
+int getLog(int src) {
+	int i;
+	int count = 0;
+
+	while(src != 1) {
+		src = src >> 1;
+		count += 1;
+	}
+
+	return count;
+}
+
+void printCacheConfig(CacheConfig config) {
+	const char* replacementPolicy = replacementPolicyName(config.replacementPolicy);
+	char* writePolicy;
+	if (config.writePolicy == WT) {
+		writePolicy = "WT";
+	} else if (config.writePolicy == WB) {
+		writePolicy = "WB";
+	}
+	printf("%d %d %d %s %s %d\n", config.size, config.numberOfEntries, config.numberOfWay, replacementPolicy, writePolicy, config.cacheHitTime);
+}
+
+static int alignToCacheLine(int size) {
+	return (size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+}
+
+void createTagStore(TagStore* lines, int numberOfLines, int lengthOfData, bool keepData) {
+	int tagsSize = alignToCacheLine(sizeof(unsigned int) * numberOfLines);
+	int flagsSize = alignToCacheLine(sizeof(unsigned char) * numberOfLines);
+	int dataSize = keepData ? alignToCacheLine(sizeof(Data) * numberOfLines * lengthOfData) : 0;
+	char* memory;
+
+	if (posix_memalign((void **) &memory, CACHE_LINE_SIZE, tagsSize + flagsSize + dataSize) != 0) {
+		printf("Cannot allocate the cache tag store\n");
+		exit(1);
+	}
+	memset(memory, 0, tagsSize + flagsSize + dataSize);
+
+	lines->memory = memory;
+	lines->tags = (unsigned int *) memory;
+	lines->flags = (unsigned char *) (memory + tagsSize);
+	lines->data = keepData ? (Data *) (memory + tagsSize + flagsSize) : NULL;
+	lines->lengthOfData = lengthOfData;
+}
+
+Cache* createCache(CacheConfig cacheConfig) {
+	Cache* cache = (Cache *)malloc(sizeof(Cache));
+	cache->config = cacheConfig;
+
+	int lengthOfData = cacheConfig.size / cacheConfig.numberOfEntries / cacheConfig.numberOfWay / sizeof(Data);
+
+	WaySet* entries = (WaySet *) malloc(sizeof(WaySet) * cacheConfig.numberOfEntries);
+
+	int i;
+	for (i = 0; i < cacheConfig.numberOfEntries; i++) {
+		entries[i].validCount = 0;
+	}
+
+	createTagStore(&cache->lines, cacheConfig.numberOfEntries * cacheConfig.numberOfWay, lengthOfData, cacheConfig.keepData);
+	createReplacementState(&cache->replacement, cacheConfig.replacementPolicy, cacheConfig.numberOfEntries, cacheConfig.numberOfWay);
+
+	cache->blockOffsetSize = getLog(lengthOfData);
+	cache->indexSize = getLog(cacheConfig.numberOfEntries);
+	cache->indexShift = 2 + cache->blockOffsetSize;
+	cache->tagShift = 2 + cache->blockOffsetSize + cache->indexSize;
+	cache->matchTag = selectTagMatch(cacheConfig.numberOfWay);
+	cache->lastHits = (unsigned int *) calloc(cacheConfig.numberOfEntries, sizeof(unsigned int));
+	cache->result.accessCount = 0;
+	cache->result.hitCount = 0;
+	cache->optTrace = NULL;
+	createMSHRFile(&cache->mshr, cacheConfig.numberOfMSHR);
+	cache->writeBuffer = NULL;
+	if (cacheConfig.writeBufferSize > 0) {
+		cache->writeBuffer = createWriteBuffer(cacheConfig.writeBufferSize);
+	}
+	cache->prefetcher = NULL;
+	if (cacheConfig.prefetcher != NO_PREFETCH) {
+		cache->prefetcher = createPrefetcher(cacheConfig.prefetcher, cacheConfig.prefetchDegree);
+	}
+	cache->sampleCounts = NULL;
+	cache->pcProfile = NULL;
+	cache->missClassifier = NULL;
+	cache->stackDistance = NULL;
+	if (cacheConfig.missRatioCurveFile != NULL) {
+		cache->stackDistance = createStackDistance(cacheConfig.numberOfEntries);
+	}
+	cache->entries = entries;
+	cache->nextLevelCache = NULL;
+
+	return cache;
+}
+
+/* The first line of the config file holds the number of levels and the
+   memory access time, optionally followed by OPT to also report the hits
+   of Belady's optimal replacement for every level and SAMPLE n to only
+   simulate one in n (a power of two) of the sets and estimate the rest
+   (see set-sampling.h). One line per level follows, from L1 down:
+
+     size numberOfEntries numberOfWay policy WT|WB hitTime [SPLIT|UNIFIED] [MSHR n]
+       [WBUF n] [PREFETCH NEXTLINE|STRIDE|STREAM [degree]] [MRC file] [3C] [DATA]
+
+   policy is LRU, FIFO, PLRU (tree pseudo-LRU), BPLRU (bit pseudo-LRU),
+   SRRIP, BRRIP or DRRIP (see replacement.c).
+
+   hitTime is the number of stall cycles of a hit in that level.
+
+   Level 1 is split into instruction and data caches and all other levels
+   are unified unless SPLIT or UNIFIED says otherwise. A split level cannot
+   follow a unified one.
+
+   MSHR n makes the level non-blocking with n miss status holding
+   registers (see loadCacheAt). Loads only overlap their misses when the
+   L1 data cache has MSHRs; a lower level without them does not limit the
+   misses in flight.
+
+   WBUF n puts an n-entry write buffer behind a WT level, so stores only
+   stall for the next level when it is full (see write-buffer.h).
+
+   PREFETCH attaches a prefetcher to every cache of the level (see
+   prefetch.c), issuing degree lines per trigger (default 1, at most 8).
+
+   MRC file writes the LRU miss ratio of every associativity of the level,
+   at its line size and number of sets, to file as CSV at exit (see
+   stack-distance.h).
+
+   3C splits the misses of every cache of the level into compulsory,
+   capacity and conflict misses (see miss-class.h).
+
+   DATA keeps a payload buffer for every line (only used by printCache). */
+void parseLevelConfig(char* buffer, int level, CacheLevel* cacheLevel) {
+	CacheConfig* c = &cacheLevel->config;
+	char* save;
+	char* temp = strtok_r(buffer, " ", &save);
+	c->size = atoi(temp);
+	temp = strtok_r(NULL, " ", &save);
+	c->numberOfEntries = atoi(temp);
+	temp = strtok_r(NULL, " ", &save);
+	c->numberOfWay = atoi(temp);
+	temp = strtok_r(NULL, " ", &save);
+	if (!parseReplacementPolicy(temp, &c->replacementPolicy)) {
+		printf("Unknown replacement policy %s in %s\n", temp, cacheConfigFile);
+		exit(1);
+	}
+	const char* error = checkReplacementPolicy(c->replacementPolicy, c->numberOfWay);
+	if (error != NULL) {
+		printf("Cannot use %s with %d ways: %s\n", temp, c->numberOfWay, error);
+		exit(1);
+	}
+	temp = strtok_r(NULL, " ", &save);
+	if (strcmp(temp, "WT") == 0) {
+		c->writePolicy = WT;
+	} else if (strcmp(temp, "WB") == 0) {
+		c->writePolicy = WB;
+	}
+	temp = strtok_r(NULL, " \r\n", &save);
+	c->cacheHitTime = atoi(temp);
+
+	cacheLevel->split = level == 1;
+	c->numberOfMSHR = 0;
+	c->writeBufferSize = 0;
+	c->prefetcher = NO_PREFETCH;
+	c->prefetchDegree = 1;
+	c->missRatioCurveFile = NULL;
+	c->classifyMisses = false;
+	c->keepData = false;
+	temp = strtok_r(NULL, " \r\n", &save);
+	while (temp != NULL) {
+		char* next = strtok_r(NULL, " \r\n", &save);
+		if (strcmp(temp, "SPLIT") == 0) {
+			cacheLevel->split = true;
+		} else if (strcmp(temp, "UNIFIED") == 0) {
+			cacheLevel->split = false;
+		} else if (strcmp(temp, "MSHR") == 0) {
+			c->numberOfMSHR = next != NULL ? atoi(next) : 0;
+			if (c->numberOfMSHR <= 0) {
+				printf("MSHR of level %d in %s needs a positive count\n", level, cacheConfigFile);
+				exit(1);
+			}
+			next = strtok_r(NULL, " \r\n", &save);
+		} else if (strcmp(temp, "WBUF") == 0) {
+			c->writeBufferSize = next != NULL ? atoi(next) : 0;
+			if (c->writeBufferSize <= 0 || c->writePolicy != WT) {
+				printf("WBUF of level %d in %s needs a positive count and a WT level\n", level, cacheConfigFile);
+				exit(1);
+			}
+			next = strtok_r(NULL, " \r\n", &save);
+		} else if (strcmp(temp, "PREFETCH") == 0) {
+			if (next == NULL || !parsePrefetcherKind(next, &c->prefetcher)) {
+				printf("Unknown prefetcher %s for level %d in %s\n", next != NULL ? next : "", level, cacheConfigFile);
+				exit(1);
+			}
+			next = strtok_r(NULL, " \r\n", &save);
+			if (next != NULL && next[0] >= '0' && next[0] <= '9') {
+				c->prefetchDegree = atoi(next);
+				if (c->prefetchDegree < 1 || c->prefetchDegree > MAX_PREFETCH_DEGREE) {
+					printf("Prefetch degree of level %d in %s must be 1 to %d\n", level, cacheConfigFile, MAX_PREFETCH_DEGREE);
+					exit(1);
+				}
+				next = strtok_r(NULL, " \r\n", &save);
+			}
+		} else if (strcmp(temp, "MRC") == 0) {
+			if (next == NULL) {
+				printf("MRC of level %d in %s needs a file name\n", level, cacheConfigFile);
+				exit(1);
+			}
+			c->missRatioCurveFile = strdup(next);
+			next = strtok_r(NULL, " \r\n", &save);
+		} else if (strcmp(temp, "3C") == 0) {
+			c->classifyMisses = true;
+		} else if (strcmp(temp, "DATA") == 0) {
+			c->keepData = true;
+		} else {
+			printf("Unknown option %s for level %d in %s\n", temp, level, cacheConfigFile);
+			exit(1);
+		}
+		temp = next;
+	}
+}
+
+void loadCacheConfig(CacheSystem* system) {
+	int i;
+	char* buffer = NULL;	// a whole line, however many options it has
+	size_t capacity = 0;
+	char* save;
+	FILE* file = fopen(cacheConfigFile, "r");
+
+	if(file == NULL){
+    printf("파일열기 실패\n");
+		exit(1);
+  }
+
+	if (getline(&buffer, &capacity, file) < 0) {
+		printf("%s is empty\n", cacheConfigFile);
+		exit(1);
+	}
+	char* temp = strtok_r(buffer, " ", &save);
+	system->numberOfLevels = atoi(temp);
+	temp = strtok_r(NULL, " \r\n", &save);
+	system->memoryAccessTime = atoi(temp);
+	system->computeOpt = false;
+	system->sampleRatio = 0;
+	system->profileTop = 0;
+	temp = strtok_r(NULL, " \r\n", &save);
+	while (temp != NULL) {
+		char* next = strtok_r(NULL, " \r\n", &save);
+		if (strcmp(temp, "OPT") == 0) {
+			system->computeOpt = true;
+		} else if (strcmp(temp, "SAMPLE") == 0) {
+			system->sampleRatio = next != NULL ? atoi(next) : 0;
+			if (system->sampleRatio < 2 || (system->sampleRatio & (system->sampleRatio - 1)) != 0) {
+				printf("SAMPLE in %s needs a power of two of at least 2\n", cacheConfigFile);
+				exit(1);
+			}
+			next = strtok_r(NULL, " \r\n", &save);
+		} else if (strcmp(temp, "PROFILE") == 0) {
+			system->profileTop = next != NULL ? atoi(next) : 0;
+			if (system->profileTop < 1) {
+				printf("PROFILE in %s needs the number of PCs to report\n", cacheConfigFile);
+				exit(1);
+			}
+			next = strtok_r(NULL, " \r\n", &save);
+		} else {
+			printf("Unknown option %s in %s\n", temp, cacheConfigFile);
+			exit(1);
+		}
+		temp = next;
+	}
+	if (system->computeOpt && system->sampleRatio > 0) {
+		printf("OPT and SAMPLE cannot be combined in %s\n", cacheConfigFile);
+		exit(1);
+	}
+
+	system->levels = (CacheLevel *) malloc(sizeof(CacheLevel) * system->numberOfLevels);
+	for (i = 0; i < system->numberOfLevels; i++) {
+		if (getline(&buffer, &capacity, file) < 0) {
+			printf("%s describes %d levels but has only %d\n", cacheConfigFile, system->numberOfLevels, i);
+			exit(1);
+		}
+		parseLevelConfig(buffer, i + 1, &system->levels[i]);
+		if (i > 0 && system->levels[i].split && !system->levels[i - 1].split) {
+			printf("Level %d of %s cannot be split below the unified level %d\n", i + 1, cacheConfigFile, i);
+			exit(1);
+		}
+	}
+
+	free(buffer);
+	fclose(file);
+}
+
+void set_cache_config_file(char* path) {
+	cacheConfigFile = path;
+}
+
+void set_pc_describer(char* (*describe)(unsigned int pc)) {
+	pcDescriber = describe;
+}
+
+/* Sample groups are numbered by the address bits that are part of the set
+   index of every cache. */
+static void createSample() {
+	int low = 0;
+	int high = 32;
+	int bits;
+	int i;
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		Cache* caches[2] = { cacheSystem.levels[i].instructionCache, cacheSystem.levels[i].dataCache };
+		int j;
+		for (j = 0; j < 2; j++) {
+			if (caches[j]->indexShift > low) {
+				low = caches[j]->indexShift;
+			}
+			if (caches[j]->indexShift + caches[j]->indexSize < high) {
+				high = caches[j]->indexShift + caches[j]->indexSize;
+			}
+		}
+	}
+	bits = high > low ? high - low : 0;
+	if (bits > MAX_SAMPLE_BITS) {
+		bits = MAX_SAMPLE_BITS;
+	}
+	if ((1 << bits) / cacheSystem.sampleRatio < MIN_SAMPLED_GROUPS) {
+		printf("SAMPLE %d needs %d groups of sets, but the levels of %s only share %d set index bits\n",
+			cacheSystem.sampleRatio, MIN_SAMPLED_GROUPS * cacheSystem.sampleRatio, cacheConfigFile, bits);
+		exit(1);
+	}
+
+	cacheSystem.sample = createSetSample(low, bits, cacheSystem.sampleRatio);
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		level->dataCache->sampleCounts = createSampleCounts(cacheSystem.sample, level->dataCache->indexShift);
+		if (level->split) {
+			level->instructionCache->sampleCounts = createSampleCounts(cacheSystem.sample, level->instructionCache->indexShift);
+		}
+	}
+}
+
+/* With SAMPLE only the sampled sets reach the classifier, so its fully
+   associative cache holds as many lines as those sets. */
+static MissClassifier* createShadowClassifier(Cache* cache) {
+	int numberOfLines = cache->config.numberOfEntries * cache->config.numberOfWay;
+
+	if (cacheSystem.sample != NULL) {
+		numberOfLines = (long long) numberOfLines * cacheSystem.sample->sampledGroups / cacheSystem.sample->numberOfGroups;
+	}
+	return createMissClassifier(numberOfLines, cache->indexShift);
+}
+
+void createCacheSystem() {
+	int i;
+
+	loadCacheConfig(&cacheSystem);
+
+	for (i = cacheSystem.numberOfLevels - 1; i >= 0; i--) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		CacheLevel* below = (i + 1 < cacheSystem.numberOfLevels) ? &cacheSystem.levels[i + 1] : NULL;
+
+		// printCacheConfig(level->config);
+		level->dataCache = createCache(level->config);
+		if (level->split) {
+			level->instructionCache = createCache(level->config);
+			snprintf(level->instructionCache->name, sizeof(level->instructionCache->name), "l%di-cache", i + 1);
+			snprintf(level->dataCache->name, sizeof(level->dataCache->name), "l%dd-cache", i + 1);
+		} else {
+			level->instructionCache = level->dataCache;
+			snprintf(level->dataCache->name, sizeof(level->dataCache->name), "l%d-cache", i + 1);
+		}
+
+		if (below != NULL) {
+			level->instructionCache->nextLevelCache = below->instructionCache;
+			level->dataCache->nextLevelCache = below->dataCache;
+		}
+
+		if (cacheSystem.computeOpt) {
+			level->dataCache->optTrace = createOptTrace();
+			if (level->split) {
+				level->instructionCache->optTrace = createOptTrace();
+			}
+		}
+		if (cacheSystem.profileTop > 0) {
+			level->dataCache->pcProfile = createPCProfile();
+			if (level->split) {
+				level->instructionCache->pcProfile = createPCProfile();
+			}
+		}
+	}
+
+	cacheSystem.L1InstructionCache = cacheSystem.levels[0].instructionCache;
+	cacheSystem.L1DataCache = cacheSystem.levels[0].dataCache;
+	cacheSystem.sample = NULL;
+	if (cacheSystem.sampleRatio > 0) {
+		createSample();
+	}
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->config.classifyMisses) {
+			level->dataCache->missClassifier = createShadowClassifier(level->dataCache);
+			if (level->split) {
+				level->instructionCache->missClassifier = createShadowClassifier(level->instructionCache);
+			}
+		}
+	}
+
+	isCacheSystemCreated = true;
+}
+
+static void freeCache(Cache* cache) {
+	free(cache->entries);
+	free(cache->lines.memory);
+	freeReplacementState(&cache->replacement);
+	free(cache->lastHits);
+	freeMSHRFile(&cache->mshr);
+	if (cache->optTrace != NULL) {
+		freeOptTrace(cache->optTrace);
+	}
+	if (cache->prefetcher != NULL) {
+		freePrefetcher(cache->prefetcher);
+	}
+	if (cache->writeBuffer != NULL) {
+		freeWriteBuffer(cache->writeBuffer);
+	}
+	if (cache->stackDistance != NULL) {
+		freeStackDistance(cache->stackDistance);
+	}
+	if (cache->sampleCounts != NULL) {
+		freeSampleCounts(cache->sampleCounts);
+	}
+	if (cache->pcProfile != NULL) {
+		freePCProfile(cache->pcProfile);
+	}
+	if (cache->missClassifier != NULL) {
+		freeMissClassifier(cache->missClassifier);
+	}
+	free(cache);
+}
+
+void free_cache_system() {
+	int i;
+
+	if (!isCacheSystemCreated) {
+		return;
+	}
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			freeCache(level->instructionCache);
+		}
+		freeCache(level->dataCache);
+		free(level->config.missRatioCurveFile);
+	}
+	free(cacheSystem.levels);
+	if (cacheSystem.sample != NULL) {
+		freeSetSample(cacheSystem.sample);
+	}
+	memset(&cacheSystem, 0, sizeof(CacheSystem));
+	instructionCount = 0;
+	isCacheSystemCreated = false;
+}
+
+void printCache(Cache* cache) {
+	int i, j, k;
+	for (i = 0; i < cache->config.numberOfEntries; i++) {
+		printf(" [%d] ||", i);
+		for (j = 0; j < cache->config.numberOfWay; j++) {
+			int line = i * cache->config.numberOfWay + j;
+			unsigned char flags = cache->lines.flags[line];
+			unsigned int tag = cache->lines.tags[line];
+			printf(" (%d) (%d) (0x%x) ", (tag & TAG_VALID) != 0, (flags & LINE_DIRTY) != 0, tag & ~TAG_VALID);
+			if (cache->lines.data != NULL) {
+				Data* data = cache->lines.data + line * cache->lines.lengthOfData;
+				for (k = 0; k < cache->lines.lengthOfData; k++) {
+					printf(" %d ", data[k]);
+				}
+			}
+			printf("|");
+		}
+		printf("\n");
+	}
+}
+
+void printCacheSystem() {
+	int i;
+
+	printf("\n");
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			printf("Level %d Instruction Cache\n", i + 1);
+			printCache(level->instructionCache);
+		}
+		printf("Level %d %s Cache\n", i + 1, level->split ? "Data" : "Unified");
+		printCache(level->dataCache);
+	}
+
+	printf("-------------------------------\n");
+}
+
+int change(Cache* cache, unsigned int addr) {
+	int stallCycles = cache->config.cacheHitTime;
+	int index = getIndex(cache, addr);
+	unsigned int tag = getTag(cache, addr);
+
+	if (cache->config.writePolicy == WT) {
+		WriteBuffer* buffer = cache->writeBuffer;
+		unsigned int line = addr >> cache->indexShift;
+		int writeCycles;
+
+		if (buffer != NULL && coalesceWrite(buffer, line, cacheSystem.clock)) {
+			return stallCycles;
+		}
+		if (cache->nextLevelCache == NULL) {
+			writeCycles = cacheSystem.memoryAccessTime;
+		} else {
+			writeCycles = change(cache->nextLevelCache, addr);
+		}
+		if (buffer != NULL) {
+			stallCycles += bufferWrite(buffer, line, writeCycles, cacheSystem.clock);
+		} else {
+			stallCycles += writeCycles;
+		}
+		// printf(" (change WT) ");
+	} else if (cache->config.writePolicy == WB) {
+		int way = findWay(cache, index, tag);
+		if (way >= 0) {
+			cache->lines.flags[index * cache->config.numberOfWay + way] |= LINE_DIRTY;
+			// printf(" (change WB) " );
+		}
+	}
+
+	return stallCycles;
+}
+
+/* Fills tag into set index with the given line flags. A prefetch fill
+   (LINE_PREFETCHED) that evicts a line in use reports it to the
+   prefetcher's pollution filter, and every fill takes the filled line out
+   of it. */
+static int fillLine(Cache* cache, int index, unsigned int tag, unsigned int addr, unsigned char lineFlags) {
+	int blockPlace;
+	int stallCycles = 0;
+	int numberOfWay = cache->config.numberOfWay;
+	int base = index * numberOfWay;
+	unsigned int* tags = cache->lines.tags + base;
+	unsigned char* flags = cache->lines.flags + base;
+	WaySet* waySet = &cache->entries[index];
+
+	if (waySet->validCount < numberOfWay) {
+		blockPlace = waySet->validCount;
+		waySet->validCount += 1;
+	} else {
+		blockPlace = chooseVictim(&cache->replacement, index);
+		// printf(" (replace %s %dth block) ", replacementPolicyName(cache->config.replacementPolicy), blockPlace);
+		if ((lineFlags & LINE_PREFETCHED) && !(flags[blockPlace] & LINE_PREFETCHED)) {
+			recordPrefetchVictim(cache->prefetcher, ((tags[blockPlace] & ~TAG_VALID) << cache->indexSize) | index);
+		}
+	}
+
+	if (flags[blockPlace] & LINE_DIRTY) {
+		if (cache->nextLevelCache == NULL) {
+			stallCycles += cacheSystem.memoryAccessTime;
+		} else {
+			stallCycles += change(cache->nextLevelCache, addr);
+		}
+	}
+
+	tags[blockPlace] = tag | TAG_VALID;
+	flags[blockPlace] = lineFlags;
+	if (cache->prefetcher != NULL) {
+		forgetPrefetchVictim(cache->prefetcher, (tag << cache->indexSize) | index);
+	}
+	cache->lastHits[index] = 0;
+	updateOnFill(&cache->replacement, index, blockPlace);
+	// printf(" (insert %x, %x, %d, %d) ", index, tag, blockPlace, instructionCount);
+	return stallCycles;
+}
+
+int insert(Cache* cache, int index, unsigned int tag, unsigned int addr) {
+	return fillLine(cache, index, tag, addr, 0);
+}
+
+bool access(Cache* cache, int index, unsigned int tag) {
+	int way;
+
+	cache->result.accessCount += 1;
+	if (cache->optTrace != NULL) {
+		recordOptReference(cache->optTrace, (tag << cache->indexSize) | index);
+	}
+	if (cache->stackDistance != NULL) {
+		recordStackReference(cache->stackDistance, (tag << cache->indexSize) | index);
+	}
+	way = findWay(cache, index, tag);
+	if (cache->sampleCounts != NULL) {
+		countSample(cache->sampleCounts, index, way >= 0);
+	}
+	if (cache->missClassifier != NULL) {
+		classifyAccess(cache->missClassifier, (tag << cache->indexSize) | index, way >= 0);
+	}
+	if (way >= 0) {
+		cache->result.hitCount += 1;
+		updateOnHit(&cache->replacement, index, way);
+		// a prefetcher has to see every access
+		cache->lastHits[index] = cache->prefetcher == NULL ? tag | TAG_VALID : 0;
+		// printf(" (hit!!) ");
+		return true;
+	}
+	cache->lastHits[index] = 0;
+	// printf(" (missㅠㅠ) ");
+	return false;
+}
+
+/* Cycles until addr would arrive in cache from below: the lower levels
+   are probed without changing them, down to memory if none has it. */
+static int prefetchLatency(Cache* cache, unsigned int addr) {
+	int latency = cache->config.cacheHitTime;
+	Cache* below;
+
+	for (below = cache->nextLevelCache; below != NULL; below = below->nextLevelCache) {
+		latency += below->config.cacheHitTime;
+		if (findWay(below, getIndex(below, addr), getTag(below, addr)) >= 0) {
+			return latency;
+		}
+	}
+	return latency + cacheSystem.memoryAccessTime;
+}
+
+/* Fills line into cache as a prefetch at cycle now unless it is already
+   there. No stall is charged and the access counts do not change; only
+   this level is filled, it does not take an MSHR, and the line is marked
+   so its first demand hit can be credited to the prefetcher. */
+static void issuePrefetch(Cache* cache, unsigned int line, long long now) {
+	unsigned int addr = line << cache->indexShift;
+	int index = getIndex(cache, addr);
+	unsigned int tag = getTag(cache, addr);
+
+	if (findWay(cache, index, tag) >= 0) {
+		return;
+	}
+	recordPrefetch(cache->prefetcher, line, now + prefetchLatency(cache, addr));
+	fillLine(cache, index, tag, addr, LINE_PREFETCHED);
+}
+
+/* Counts a demand miss of cache on addr for its prefetcher, before the
+   line is filled and leaves the pollution filter. */
+static void countDemandMiss(Cache* cache, unsigned int addr) {
+	Prefetcher* prefetcher = cache->prefetcher;
+
+	prefetcher->stats.demandMisses += 1;
+	if (checkPollution(prefetcher, addr >> cache->indexShift)) {
+		prefetcher->stats.pollutionMisses += 1;
+	}
+}
+
+/* Updates the prefetcher of cache after a demand access (hit tells how it
+   went) and issues the prefetches it asks for. Returns the cycle at which
+   the accessed line arrives when it is a prefetch still in flight, and 0
+   otherwise. */
+static long long prefetchOnAccess(Cache* cache, unsigned int addr, unsigned int pc, bool hit, long long now) {
+	Prefetcher* prefetcher = cache->prefetcher;
+	unsigned int line = addr >> cache->indexShift;
+	unsigned int lines[MAX_PREFETCH_DEGREE];
+	long long readyCycle = 0;
+	bool trigger = !hit;
+	int i, count;
+
+	if (hit) {
+		int index = getIndex(cache, addr);
+		unsigned char* flags = cache->lines.flags + index * cache->config.numberOfWay + findWay(cache, index, getTag(cache, addr));
+		if (*flags & LINE_PREFETCHED) {
+			*flags &= ~LINE_PREFETCHED;
+			prefetcher->stats.useful += 1;
+			readyCycle = prefetchReadyCycle(prefetcher, line);
+			if (readyCycle > now) {
+				prefetcher->stats.late += 1;
+				prefetcher->stats.lateCycles += readyCycle - now;
+			} else {
+				readyCycle = 0;
+			}
+			trigger = true;
+		}
+	}
+
+	count = trainPrefetcher(prefetcher, addr, pc, trigger, cache->indexShift, lines);
+	for (i = 0; i < count; i++) {
+		issuePrefetch(cache, lines[i], now);
+	}
+	return readyCycle;
+}
+
+int loadCache(Cache* cache, unsigned int addr, unsigned int pc) {
+	int stallCycle = cache->config.cacheHitTime;
+	int index = getIndex(cache, addr);
+	unsigned int tag = getTag(cache, addr);
+	bool hit;
+
+	if (cache->lastHits[index] == (tag | TAG_VALID)) {
+		cache->result.accessCount += 1;
+		cache->result.hitCount += 1;
+		if (cache->optTrace != NULL) {
+			recordOptReference(cache->optTrace, addr >> cache->indexShift);
+		}
+		if (cache->stackDistance != NULL) {
+			recordStackReference(cache->stackDistance, addr >> cache->indexShift);
+		}
+		if (cache->sampleCounts != NULL) {
+			countSample(cache->sampleCounts, index, true);
+		}
+		if (cache->missClassifier != NULL) {
+			classifyAccess(cache->missClassifier, addr >> cache->indexShift, true);
+		}
+		if (cache->pcProfile != NULL) {
+			recordPCAccess(cache->pcProfile, pc, true);
+		}
+		return stallCycle;
+	}
+
+	hit = access(cache, index, tag);
+	if (cache->pcProfile != NULL) {
+		recordPCAccess(cache->pcProfile, pc, hit);
+	}
+	if (!hit) {
+		if (cache->prefetcher != NULL) {
+			countDemandMiss(cache, addr);
+		}
+		if (cache->nextLevelCache == NULL) {
+			stallCycle += cacheSystem.memoryAccessTime;
+		} else {
+			stallCycle += loadCache(cache->nextLevelCache, addr, pc);
+		}
+		stallCycle += insert(cache, index, tag, addr);
+	}
+
+	if (cache->prefetcher != NULL) {
+		long long readyCycle = prefetchOnAccess(cache, addr, pc, hit, cacheSystem.clock);
+		if (readyCycle - cacheSystem.clock > stallCycle) {
+			stallCycle = readyCycle - cacheSystem.clock;
+		}
+	}
+
+	return stallCycle;
+}
+
+/* Completion-time version of loadCache used by non-blocking loads.
+   Returns the cycle at which the line reaches cache for a request made at
+   cycle now. Hit and miss counts are the same as with loadCache: the line
+   is installed when the miss is sent, so a later access to it hits, but
+   while the fill is in flight that access is a secondary miss and has to
+   wait for it. A primary miss takes an MSHR, waiting for one to free up
+   if all are busy. Without MSHRs the result is now + loadCache(). */
+long long loadCacheAt(Cache* cache, unsigned int addr, unsigned int pc, long long now) {
+	int index = getIndex(cache, addr);
+	unsigned int tag = getTag(cache, addr);
+	unsigned int line = addr >> cache->indexShift;
+	MSHRFile* mshr = &cache->mshr;
+	long long start = now;
+	long long readyCycle = now + cache->config.cacheHitTime;
+	int entry = -1;
+	bool hit = access(cache, index, tag);
+
+	if (cache->pcProfile != NULL) {
+		recordPCAccess(cache->pcProfile, pc, hit);
+	}
+	if (hit) {
+		if (cache->prefetcher != NULL) {
+			long long prefetchReady = prefetchOnAccess(cache, addr, pc, true, now);
+			if (prefetchReady > readyCycle) {
+				readyCycle = prefetchReady;
+			}
+		}
+		if (mshr->count > 0 && (entry = findMSHR(mshr, line, now)) >= 0) {
+			mshr->secondaryMisses += 1;
+			if (mshr->entries[entry].readyCycle > readyCycle) {
+				readyCycle = mshr->entries[entry].readyCycle;
+			}
+		}
+		return readyCycle;
+	}
+
+	if (cache->prefetcher != NULL) {
+		countDemandMiss(cache, addr);
+	}
+	if (mshr->count > 0) {
+		start = allocateMSHR(mshr, now, &entry);
+		readyCycle = start + cache->config.cacheHitTime;
+	}
+	if (cache->nextLevelCache == NULL) {
+		readyCycle += cacheSystem.memoryAccessTime;
+	} else {
+		readyCycle = loadCacheAt(cache->nextLevelCache, addr, pc, readyCycle);
+	}
+	readyCycle += insert(cache, index, tag, addr);
+	if (entry >= 0) {
+		fillMSHR(mshr, entry, line, start, readyCycle);
+	}
+	if (cache->prefetcher != NULL) {
+		prefetchOnAccess(cache, addr, pc, false, now);
+	}
+
+	return readyCycle;
+}
+
+int loadInstCache(unsigned int addr) {
+	return loadCache(cacheSystem.L1InstructionCache, addr, addr);
+}
+
+int loadDataCache(unsigned int addr, unsigned int pc) {
+	return loadCache(cacheSystem.L1DataCache, addr, pc);
+}
+
+int storeDataCache(unsigned int addr) {
+	return change(cacheSystem.L1DataCache, addr);
+}
+
+/* Stall cycles of a reference to a set that is left out by set sampling,
+   which is taken as a hit in cache, or -1 when the set is simulated. */
+static inline int skipUnsampled(Cache* cache, unsigned int addr) {
+	if (cacheSystem.sample == NULL || isSampled(cacheSystem.sample, addr)) {
+		return -1;
+	}
+	return cache->config.cacheHitTime;
+}
+
+int data_load (unsigned int addr, unsigned int pc) {
+	/* You have to implement your own data_load function here! */
+	int stallCycles = 0;
+	instructionCount += 1;
+	if (instructionCount <= IGNORED_REFERENCES) return 0;
+
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+
+	int skipped = skipUnsampled(cacheSystem.L1DataCache, addr);
+	if (skipped >= 0) {
+		cacheSystem.clock += skipped;
+		cacheSystem.stallCycles += skipped;
+		return skipped;
+	}
+
+	stallCycles += loadDataCache(addr, pc);
+	cacheSystem.clock += stallCycles;
+	cacheSystem.stallCycles += stallCycles;
+
+	// printf("\nLOAD DATA - 0x%x (%d)\n", addr, stallCycles);
+	// printCacheSystem();
+
+	return stallCycles;
+	// Return value: stall cycles due to L1 cache miss
+	///////////////////////////////////////////////////////////
+}
+
+bool nonblocking_data_cache() {
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+	return cacheSystem.L1DataCache->mshr.count > 0;
+}
+
+/* Non-blocking load issued at cycle. The pipeline only stalls here when
+   every MSHR of the L1 data cache is busy; the returned stall cycles are
+   that wait. readyCycle is the cycle the loaded word is available, an
+   instruction that reads it has to wait until then. */
+int data_load_nonblocking(unsigned int addr, unsigned int pc, int cycle, int* readyCycle) {
+	MSHRFile* mshr;
+	long long fullStallCycles;
+
+	*readyCycle = cycle;
+	instructionCount += 1;
+	if (instructionCount <= IGNORED_REFERENCES) return 0;
+
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+
+	int skipped = skipUnsampled(cacheSystem.L1DataCache, addr);
+	if (skipped >= 0) {
+		*readyCycle = cycle + skipped;
+		return 0;
+	}
+
+	mshr = &cacheSystem.L1DataCache->mshr;
+	fullStallCycles = mshr->fullStallCycles;
+	*readyCycle = loadCacheAt(cacheSystem.L1DataCache, addr, pc, cycle);
+	if (cycle > cacheSystem.clock) {
+		cacheSystem.clock = cycle;
+	}
+	cacheSystem.stallCycles += mshr->fullStallCycles - fullStallCycles;
+
+	return mshr->fullStallCycles - fullStallCycles;
+}
+
+/* Fetches the instruction at addr. The cache clock advances by
+   issueCycles, the cycles the instruction takes on its own, and by the
+   stalls of the fetch. */
+static int fetchInstruction(unsigned int addr, int issueCycles) {
+	int stallCycles = 0;
+	instructionCount += 1;
+	if (instructionCount <= IGNORED_REFERENCES) return 0;
+	
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+
+	int skipped = skipUnsampled(cacheSystem.L1InstructionCache, addr);
+	if (skipped >= 0) {
+		cacheSystem.clock += issueCycles + skipped;
+		cacheSystem.stallCycles += skipped;
+		return skipped;
+	}
+
+	stallCycles += loadInstCache(addr);
+	cacheSystem.clock += issueCycles + stallCycles;
+	cacheSystem.stallCycles += stallCycles;
+
+	// printf("\nLOAD INST - 0x%x (%d)\n", addr, stallCycles);
+	// printCacheSystem();
+
+	return stallCycles;
+	// Return value: stall cycles due to L1 cache miss 
+	///////////////////////////////////////////////////////////
+}
+
+int instruction_load (unsigned int addr) {
+	/* You have to implement your own instruction_load function here! */
+	return fetchInstruction(addr, 1);
+}
+
+int paired_instruction_load(unsigned int addr) {
+	return fetchInstruction(addr, 0);
+}
+
+int data_store(unsigned int addr, unsigned int pc) {
+	/* You have to implement your own data_store function here! */
+	int stallCycles = 0;
+	instructionCount += 1;
+	if (instructionCount <= IGNORED_REFERENCES) return 0;
+
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+
+	// a store hit costs the lookup and the write
+	int skipped = skipUnsampled(cacheSystem.L1DataCache, addr);
+	if (skipped >= 0) {
+		cacheSystem.clock += 2 * skipped;
+		cacheSystem.stallCycles += 2 * skipped;
+		return 2 * skipped;
+	}
+
+	stallCycles += loadDataCache(addr, pc);
+	stallCycles += storeDataCache(addr);
+	cacheSystem.clock += stallCycles;
+	cacheSystem.stallCycles += stallCycles;
+	
+	// printf("\nSTORE DATA - 0x%x (%d)\n", addr, stallCycles);
+	// printCacheSystem();
+
+	return stallCycles;
+	// Return value: stall cycles due to L1 cache miss
+	///////////////////////////////////////////////////////////
+}
+
+/* Replay the references recorded for cache through a cache of the same
+   geometry with Belady replacement. Only hits and misses are counted, so
+   write policies and the next level do not matter here. */
+Result simulateOpt(Cache* cache) {
+	unsigned int i;
+	CacheConfig config = cache->config;
+	OptTrace* trace = cache->optTrace;
+
+	config.replacementPolicy = OPT;
+	config.numberOfMSHR = 0;
+	config.writeBufferSize = 0;
+	config.prefetcher = NO_PREFETCH;
+	config.missRatioCurveFile = NULL;
+	config.keepData = false;
+	Cache* opt = createCache(config);
+	unsigned int* nextUse = computeNextUse(trace);
+
+	for (i = 0; i < trace->length; i++) {
+		unsigned int line = trace->lines[i];
+		int index = line & (config.numberOfEntries - 1);
+		unsigned int tag = line >> opt->indexSize;
+
+		opt->replacement.currentNextUse = nextUse[i];
+		if (!access(opt, index, tag)) {
+			insert(opt, index, tag, line << opt->indexShift);
+		}
+	}
+
+	Result result = opt->result;
+	free(nextUse);
+	freeCache(opt);
+	return result;
+}
+
+void printOptResult(Cache* cache) {
+	if (cache->optTrace == NULL) {
+		return;
+	}
+	Result opt = simulateOpt(cache);
+	float optHitRate = (float) opt.hitCount / opt.accessCount;
+
+	if (cache->optTrace->truncated) {
+		printf("(OPT only covers the first %u references)\n", cache->optTrace->length);
+	}
+	printf("OPT Hit Count: %lld\n", opt.hitCount);
+	printf("OPT Miss Count: %lld\n", opt.accessCount - opt.hitCount);
+	printf("OPT Hit Ratio: %0.3f\n", optHitRate);
+}
+
+/* Caches of a split level are printed with their name, a unified level
+   just as the level. */
+void printCacheResult(Cache* cache, bool named) {
+	Result estimate = estimatedResult(cache);
+	Result* result = &estimate;
+	float hitRate = (float) result->hitCount / result->accessCount;
+
+	if (named) {
+		printf("Hit Count of %s: %lld\n", cache->name, result->hitCount);
+		printf("Miss Count of %s: %lld\n", cache->name, result->accessCount - result->hitCount);
+		printf("Hit Ratio of %s: %0.3f\n", cache->name, hitRate);
+	} else {
+		printf("Hit Count: %lld\n", result->hitCount);
+		printf("Miss Count: %lld\n", result->accessCount - result->hitCount);
+		printf("Hit Ratio: %0.3f\n", hitRate);
+	}
+	if (cache->sampleCounts != NULL && cache->sampleCounts->errorBound < 0) {
+		printf("Hit Ratio Error: unknown, no sampled set was accessed\n");
+	} else if (cache->sampleCounts != NULL) {
+		printf("Hit Ratio Error: %0.3f (95%% confidence)\n", cache->sampleCounts->errorBound);
+	}
+	printOptResult(cache);
+}
+
+/* The counts of cache, estimated over all sets when only a sample of the
+   sets was simulated. cache->result keeps the counts of the sampled sets,
+   so the estimate can be taken again as the run goes on. */
+Result estimatedResult(Cache* cache) {
+	Result result = cache->result;
+
+	if (cache->sampleCounts != NULL) {
+		estimateSample(cacheSystem.sample, cache->sampleCounts, &result.accessCount, &result.hitCount);
+	}
+	return result;
+}
+
+/* All caches of a level go into the level's file, one row per cache and
+   associativity. */
+static void writeLevelMissRatioCurve(int number, CacheLevel* level) {
+	char* path = level->config.missRatioCurveFile;
+	int lineSize = level->dataCache->lines.lengthOfData * sizeof(Data);
+	FILE* file;
+
+	if (path == NULL) {
+		return;
+	}
+	file = fopen(path, "w");
+	if (file == NULL) {
+		printf("Cannot write the miss ratio curve of level %d to %s\n", number, path);
+		return;
+	}
+	fprintf(file, "cache,ways,size,misses,miss_ratio\n");
+	if (level->split) {
+		writeMissRatioCurve(file, level->instructionCache->name, level->instructionCache->stackDistance, lineSize);
+	}
+	writeMissRatioCurve(file, level->dataCache->name, level->dataCache->stackDistance, lineSize);
+	fclose(file);
+	printf("Miss ratio curve of level %d written to %s\n", number, path);
+}
+
+void print_cache_result(int n_cycles) {
+	/* You have to print the result of hit/miss count of each cache. You have to follow the format as below example.
+	Calculate hit ratio down to three places of decimals.
+	Example)
+	Level 1 Cache
+	Hit Count of l1i-cache: 4
+	Miss Count of l1i-cache: 5
+	Hit Ratio of l1i-cache: 0.444
+
+	Hit Count of l1d-cache: 1
+	Miss Count of l1d-cache: 3
+	Hit Ratio of l1d-cache: 0.250
+
+	Level 2 Cache
+	Hit Count: 0
+	Miss Count: 8
+	Hit Ratio: 0.000
+
+	Total Hit Ratio: 0.385
+	*/
+
+	/* You have to implement your own print_cache_result function here! */
+	int i;
+	instructionCount += 1;
+
+	if (!isCacheSystemCreated) {
+		createCacheSystem();
+	}
+
+	float totalAccessCount = estimatedResult(cacheSystem.L1InstructionCache).accessCount;
+	if (cacheSystem.levels[0].split) {
+		totalAccessCount += estimatedResult(cacheSystem.L1DataCache).accessCount;
+	}
+	float totalHitCount = 0;
+
+	printf("\n");
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+
+		printf("Level %d Cache\n", i + 1);
+		if (level->split) {
+			printCacheResult(level->instructionCache, true);
+			printf("\n");
+			totalHitCount += estimatedResult(level->instructionCache).hitCount;
+		}
+		printCacheResult(level->dataCache, level->split);
+		printf("\n");
+		totalHitCount += estimatedResult(level->dataCache).hitCount;
+	}
+	printf("Total Hit Ratio: %0.3f\n", totalHitCount / totalAccessCount);
+	if (cacheSystem.sample != NULL) {
+		SetSample* sample = cacheSystem.sample;
+		printf("Set Sampling: %d of %d set groups simulated (%0.3f of the sets)\n",
+			sample->sampledGroups, sample->numberOfGroups, (float) sample->sampledGroups / sample->numberOfGroups);
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			printReplacementStats(level->instructionCache->name, &level->instructionCache->replacement);
+		}
+		printReplacementStats(level->dataCache->name, &level->dataCache->replacement);
+	}
+
+	// instruction fetches are blocking, so only the data side uses MSHRs
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		printMSHRStats(cacheSystem.levels[i].dataCache->name, &cacheSystem.levels[i].dataCache->mshr, n_cycles);
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		if (cacheSystem.levels[i].dataCache->writeBuffer != NULL) {
+			printWriteBufferStats(cacheSystem.levels[i].dataCache->name, cacheSystem.levels[i].dataCache->writeBuffer);
+		}
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split && level->instructionCache->prefetcher != NULL) {
+			printPrefetchStats(level->instructionCache->name, level->instructionCache->prefetcher);
+		}
+		if (level->dataCache->prefetcher != NULL) {
+			printPrefetchStats(level->dataCache->name, level->dataCache->prefetcher);
+		}
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		double scale = cacheSystem.sample != NULL ? (double) cacheSystem.sample->numberOfGroups / cacheSystem.sample->sampledGroups : 1.0;
+		if (level->split && level->instructionCache->missClassifier != NULL) {
+			printMissClasses(level->instructionCache->name, level->instructionCache->missClassifier, scale);
+		}
+		if (level->dataCache->missClassifier != NULL) {
+			printMissClasses(level->dataCache->name, level->dataCache->missClassifier, scale);
+		}
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		writeLevelMissRatioCurve(i + 1, &cacheSystem.levels[i]);
+	}
+
+	for (i = 0; i < cacheSystem.numberOfLevels && cacheSystem.profileTop > 0; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			printPCProfile(level->instructionCache->name, level->instructionCache->pcProfile, cacheSystem.profileTop, pcDescriber);
+		}
+		printPCProfile(level->dataCache->name, level->dataCache->pcProfile, cacheSystem.profileTop, pcDescriber);
+	}
+
+	//////////////////////////////////////////////////////////////////////
+}
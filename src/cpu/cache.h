@@ -8,9 +8,15 @@
 #include <string.h>
 
 /* Exported functions for cache */
-int data_load(unsigned int);			// data load operation
-int data_store(unsigned int);			// data store operation
+int data_load(unsigned int addr, unsigned int pc);	// data load operation
+int data_store(unsigned int addr, unsigned int pc);	// data store operation
 int instruction_load(unsigned int);	// instruction load operation
+int paired_instruction_load(unsigned int addr);	// instruction load of an instruction issued in the cycle of the one before it
+int data_load_nonblocking(unsigned int addr, unsigned int pc, int cycle, int* readyCycle);	// data load that overlaps its miss
+bool nonblocking_data_cache();		// true when the L1 data cache has MSHRs
 void print_cache_result(int n_cycles);		// print final result of hit/miss ratio
+void set_cache_config_file(char* path);	// read the cache configuration from path
+void free_cache_system();		// release the hierarchy, the next access builds it again from the configuration file
+void set_pc_describer(char* (*describe)(unsigned int pc));	// label and disassembly of a PC in the PROFILE report
 
 #endif
@@ -0,0 +1,107 @@
+/* Throughput benchmark for the cache model.
+   Replays a synthetic reference stream (a loop body fetched from the text
+   segment, strided array walks and scattered heap accesses) through the
+   exported cache interface and reports accesses per second.
+
+   usage: cache_bench [config file] [number of references] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cache.h"
+
+#define TEXT_BASE 0x00400000
+#define DATA_BASE 0x10000000
+#define HEAP_BASE 0x10040000
+
+typedef enum RefKind {
+	REF_INST, REF_LOAD, REF_STORE,
+} RefKind;
+
+typedef struct Ref {
+	RefKind kind;
+	unsigned int addr;
+	unsigned int pc;
+} Ref;
+
+static unsigned int seed = 12345;
+
+static unsigned int nextRandom() {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static void buildStream(Ref* refs, int count) {
+	int i = 0;
+	unsigned int pc = TEXT_BASE;
+	unsigned int arrayOffset = 0;
+
+	while (i < count) {
+		refs[i].kind = REF_INST;
+		refs[i].addr = pc;
+		refs[i].pc = pc;
+		i += 1;
+		pc = (pc + 4 >= TEXT_BASE + 0x800) ? TEXT_BASE : pc + 4;
+
+		if (i < count && (pc & 0xc) == 0) {
+			unsigned int r = nextRandom();
+			refs[i].kind = (r & 3) == 0 ? REF_STORE : REF_LOAD;
+			refs[i].pc = pc;
+			if (r & 0x10) {
+				refs[i].addr = DATA_BASE + arrayOffset;
+				arrayOffset = (arrayOffset + 4) & 0xfffff;
+			} else {
+				refs[i].addr = HEAP_BASE + ((r >> 5) & 0x3ffffc);
+			}
+			i += 1;
+		}
+	}
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+	int i;
+	int count = 4000000;
+	long long stallCycles = 0;
+
+	if (argc > 1) {
+		set_cache_config_file(argv[1]);
+	}
+	if (argc > 2) {
+		count = atoi(argv[2]);
+	}
+
+	Ref* refs = (Ref *) malloc(sizeof(Ref) * count);
+	buildStream(refs, count);
+
+	double start = now();
+	for (i = 0; i < count; i++) {
+		switch (refs[i].kind) {
+		case REF_INST:
+			stallCycles += instruction_load(refs[i].addr);
+			break;
+		case REF_LOAD:
+			stallCycles += data_load(refs[i].addr, refs[i].pc);
+			break;
+		case REF_STORE:
+			stallCycles += data_store(refs[i].addr, refs[i].pc);
+			break;
+		}
+	}
+	double elapsed = now() - start;
+
+	print_cache_result(0);
+	printf("\nReferences: %d\n", count);
+	printf("Stall Cycles: %lld\n", stallCycles);
+	printf("Elapsed: %0.3f s\n", elapsed);
+	printf("Accesses per second: %0.0f\n", count / elapsed);
+
+	free(refs);
+	return 0;
+}
@@ -0,0 +1,352 @@
+/* Trace-driven cache simulator.
+   Replays a trace captured with "spim -trace" through the exported cache
+   interface and prints the same report as spim does at exit, without the
+   assembler, the interpreter and the hazard logic. Loads are replayed as
+   blocking loads, since there is no pipeline to overlap them with.
+
+   With -j n the replay is split by set over n worker threads (see
+   replaySharded); the report is identical to the serial one.
+
+   usage: cachesim [-j threads] trace [config file] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "cache-model.h"
+#include "trace.h"
+
+#define SHARD_BLOCK_SIZE 4096	// references per block
+#define SHARD_QUEUE_SIZE 8	// blocks per queue
+
+/* References of one shard, handed over as a whole. */
+typedef struct ShardBlock {
+	int count;
+	unsigned char kinds[SHARD_BLOCK_SIZE];
+	unsigned int addrs[SHARD_BLOCK_SIZE];
+	unsigned int pcs[SHARD_BLOCK_SIZE];
+} ShardBlock;
+
+/* Single-producer single-consumer ring of blocks from the decoder to one
+   worker. Only the decoder writes tail and done, only the worker head;
+   each is published with release and read with acquire ordering, and
+   they sit on separate cache lines. */
+typedef struct ShardQueue {
+	ShardBlock blocks[SHARD_QUEUE_SIZE];
+	unsigned int head;
+	char headPadding[CACHE_LINE_SIZE - sizeof(unsigned int)];
+	unsigned int tail;
+	bool done;
+	char tailPadding[CACHE_LINE_SIZE - sizeof(unsigned int) - sizeof(bool)];
+} ShardQueue;
+
+typedef struct Shard {
+	pthread_t thread;
+	ShardQueue* queue;
+	char* config;	// NULL for the default configuration file
+	Result* results;	// per cache, in report order
+	long long stallCycles;
+} Shard;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long long replaySerial(TraceReader* reader, long long* references) {
+	TraceBatch* batch = &reader->batch;
+	long long stallCycles = 0;
+	int i;
+
+	while (readTraceBatch(reader) > 0) {
+		for (i = 0; i < batch->count; i++) {
+			switch (batch->kinds[i]) {
+			case TRACE_INST:
+				stallCycles += instruction_load(batch->addrs[i]);
+				break;
+			case TRACE_LOAD:
+				stallCycles += data_load(batch->addrs[i], batch->pcs[i]);
+				break;
+			case TRACE_STORE:
+				stallCycles += data_store(batch->addrs[i], batch->pcs[i]);
+				break;
+			}
+		}
+		*references += batch->count;
+	}
+	return stallCycles;
+}
+
+/* Caches of the hierarchy of this thread in report order. */
+static int listCaches(Cache** caches) {
+	int count = 0;
+	int i;
+
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		if (cacheSystem.levels[i].split) {
+			caches[count++] = cacheSystem.levels[i].instructionCache;
+		}
+		caches[count++] = cacheSystem.levels[i].dataCache;
+	}
+	return count;
+}
+
+/* Why the hierarchy of this thread cannot be split by set, or NULL. */
+static const char* shardingProblem() {
+	int i;
+
+	if (cacheSystem.computeOpt) {
+		return "OPT needs the whole reference stream of a level";
+	}
+	if (cacheSystem.sample != NULL) {
+		return "SAMPLE filters references in the exported interface, which the workers bypass";
+	}
+	if (cacheSystem.profileTop > 0) {
+		return "PROFILE counts per PC are not merged across shards";
+	}
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheConfig* config = &cacheSystem.levels[i].config;
+		if (config->replacementPolicy == BRRIP || config->replacementPolicy == DRRIP) {
+			return "BRRIP and DRRIP keep state across sets";
+		}
+		if (config->prefetcher != NO_PREFETCH) {
+			return "prefetchers are trained across sets";
+		}
+		if (config->writeBufferSize > 0) {
+			return "write buffers are shared by all sets";
+		}
+		if (config->missRatioCurveFile != NULL) {
+			return "MRC needs the whole reference stream of a level";
+		}
+		if (config->classifyMisses) {
+			return "3C shadows a fully associative cache across all sets";
+		}
+	}
+	return NULL;
+}
+
+/* Number of shard bits: address bits that are part of the set index of
+   every cache, starting at *shift. */
+static int sharedIndexBits(int* shift) {
+	Cache** caches = (Cache **) malloc(sizeof(Cache *) * 2 * cacheSystem.numberOfLevels);
+	int count = listCaches(caches);
+	int low = 0;
+	int high = 32;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (caches[i]->indexShift > low) {
+			low = caches[i]->indexShift;
+		}
+		if (caches[i]->indexShift + caches[i]->indexSize < high) {
+			high = caches[i]->indexShift + caches[i]->indexSize;
+		}
+	}
+	free(caches);
+	*shift = low;
+	return high > low ? high - low : 0;
+}
+
+static ShardBlock* nextBlock(ShardQueue* queue) {
+	unsigned int tail = queue->tail;
+
+	while (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == SHARD_QUEUE_SIZE) {
+		sched_yield();
+	}
+	queue->blocks[tail % SHARD_QUEUE_SIZE].count = 0;
+	return &queue->blocks[tail % SHARD_QUEUE_SIZE];
+}
+
+static void publishBlock(ShardQueue* queue) {
+	__atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* A worker replays its blocks through the model directly; the decoder
+   already dropped the references the exported interface ignores. */
+static void* runShard(void* arg) {
+	Shard* shard = (Shard *) arg;
+	ShardQueue* queue = shard->queue;
+	Cache** caches;
+	int count;
+	int i;
+
+	if (shard->config != NULL) {
+		set_cache_config_file(shard->config);
+	}
+	createCacheSystem();
+	caches = (Cache **) malloc(sizeof(Cache *) * 2 * cacheSystem.numberOfLevels);
+	for (;;) {
+		unsigned int head = queue->head;
+		ShardBlock* block;
+
+		while (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == head) {
+			if (__atomic_load_n(&queue->done, __ATOMIC_ACQUIRE) && __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == head) {
+				count = listCaches(caches);
+				for (i = 0; i < count; i++) {
+					shard->results[i] = caches[i]->result;
+				}
+				free(caches);
+				free_cache_system();
+				return NULL;
+			}
+			sched_yield();
+		}
+
+		block = &queue->blocks[head % SHARD_QUEUE_SIZE];
+		for (i = 0; i < block->count; i++) {
+			switch (block->kinds[i]) {
+			case TRACE_INST:
+				shard->stallCycles += loadInstCache(block->addrs[i]);
+				break;
+			case TRACE_LOAD:
+				shard->stallCycles += loadDataCache(block->addrs[i], block->pcs[i]);
+				break;
+			case TRACE_STORE:
+				shard->stallCycles += loadDataCache(block->addrs[i], block->pcs[i]);
+				shard->stallCycles += storeDataCache(block->addrs[i]);
+				break;
+			}
+		}
+		__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+	}
+}
+
+/* Split replay. Every set-local structure of a cache is only touched by
+   references to its set, and a dirty eviction or write-through goes to
+   the next level with the address of the reference. So when the shard is
+   chosen by address bits that are part of the set index of every cache,
+   each worker owns whole sets of every cache and sees their references in
+   trace order, and the counts of the shards add up to those of the serial
+   replay. The decoder runs on this thread, routing references in blocks;
+   the merged counts are left in this thread's hierarchy. */
+static long long replaySharded(TraceReader* reader, char* config, int numberOfThreads, long long* references) {
+	TraceBatch* batch = &reader->batch;
+	Cache** caches = (Cache **) malloc(sizeof(Cache *) * 2 * cacheSystem.numberOfLevels);
+	int numberOfCaches;
+	long long stallCycles = 0;
+	long long ignored = 0;
+	int shift;
+	int bits = sharedIndexBits(&shift);
+	int numberOfShards = 1;
+	int i, j;
+	const char* problem = shardingProblem();
+
+	if (problem != NULL) {
+		printf("Cannot split the replay by set: %s\n", problem);
+		exit(1);
+	}
+	while (numberOfShards * 2 <= numberOfThreads && bits > 0) {
+		numberOfShards *= 2;
+		bits -= 1;
+	}
+	numberOfCaches = listCaches(caches);
+
+	Shard* shards = (Shard *) calloc(numberOfShards, sizeof(Shard));
+	ShardBlock** blocks = (ShardBlock **) malloc(sizeof(ShardBlock *) * numberOfShards);
+	for (i = 0; i < numberOfShards; i++) {
+		if (posix_memalign((void **) &shards[i].queue, CACHE_LINE_SIZE, sizeof(ShardQueue)) != 0) {
+			printf("Cannot allocate the shard queues\n");
+			exit(1);
+		}
+		memset(shards[i].queue, 0, sizeof(ShardQueue));
+		shards[i].config = config;
+		shards[i].results = (Result *) calloc(numberOfCaches, sizeof(Result));
+		blocks[i] = nextBlock(shards[i].queue);
+		if (pthread_create(&shards[i].thread, NULL, runShard, &shards[i]) != 0) {
+			printf("Cannot start shard %d\n", i);
+			exit(1);
+		}
+	}
+
+	while (readTraceBatch(reader) > 0) {
+		for (i = 0; i < batch->count; i++) {
+			unsigned int addr = batch->addrs[i];
+			int shard = (addr >> shift) & (numberOfShards - 1);
+			ShardBlock* block;
+
+			if (ignored < IGNORED_REFERENCES) {
+				ignored += 1;
+				continue;
+			}
+			block = blocks[shard];
+			block->kinds[block->count] = batch->kinds[i];
+			block->addrs[block->count] = addr;
+			block->pcs[block->count] = batch->pcs[i];
+			block->count += 1;
+			if (block->count == SHARD_BLOCK_SIZE) {
+				publishBlock(shards[shard].queue);
+				blocks[shard] = nextBlock(shards[shard].queue);
+			}
+		}
+		*references += batch->count;
+	}
+
+	for (i = 0; i < numberOfShards; i++) {
+		if (blocks[i]->count > 0) {
+			publishBlock(shards[i].queue);
+		}
+		__atomic_store_n(&shards[i].queue->done, true, __ATOMIC_RELEASE);
+	}
+	for (i = 0; i < numberOfShards; i++) {
+		pthread_join(shards[i].thread, NULL);
+		for (j = 0; j < numberOfCaches; j++) {
+			caches[j]->result.accessCount += shards[i].results[j].accessCount;
+			caches[j]->result.hitCount += shards[i].results[j].hitCount;
+		}
+		stallCycles += shards[i].stallCycles;
+		free(shards[i].results);
+		free(shards[i].queue);
+	}
+	free(blocks);
+	free(shards);
+	free(caches);
+
+	fprintf(stderr, "\nShards: %d (set index bits from %d)", numberOfShards, shift);
+	return stallCycles;
+}
+
+int main(int argc, char** argv) {
+	int first = 1;
+	int numberOfThreads = 1;
+	char* config = NULL;
+	long long references = 0;
+	long long stallCycles;
+
+	if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+		numberOfThreads = atoi(argv[2]);
+		first = 3;
+	}
+	if (argc - first < 1 || numberOfThreads < 1) {
+		printf("usage: cachesim [-j threads] trace [config file]\n");
+		return 1;
+	}
+	if (argc - first > 1) {
+		config = argv[first + 1];
+		set_cache_config_file(config);
+	}
+
+	TraceReader* reader = openTraceReader(argv[first]);
+
+	double start = now();
+	if (numberOfThreads > 1) {
+		// the workers read the configuration that this thread uses
+		nonblocking_data_cache();
+		stallCycles = replaySharded(reader, config, numberOfThreads, &references);
+	} else {
+		stallCycles = replaySerial(reader, &references);
+	}
+	double elapsed = now() - start;
+	closeTraceReader(reader);
+
+	print_cache_result(0);
+	fprintf(stderr, "\nReferences: %lld\n", references);
+	fprintf(stderr, "Stall Cycles: %lld\n", stallCycles);
+	fprintf(stderr, "Elapsed: %0.3f s\n", elapsed);
+	fprintf(stderr, "References per second: %0.0f\n", references / elapsed);
+	return 0;
+}
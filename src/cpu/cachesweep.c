@@ -0,0 +1,275 @@
+/* Parallel configuration sweep.
+   Replays one trace through every given cache configuration and prints
+   one CSV table with a row per cache and a total row per configuration,
+   in the order the configurations were given. The OPT columns of a cache
+   hold the hits of Belady's replacement on its references when the
+   configuration asks for OPT, and are empty otherwise and in total rows.
+
+   The trace is mapped once and every replay decodes it through its own
+   view of that mapping, so the workers share one copy of the reference
+   stream and hold only the chunk they are on. The cache model keeps its
+   hierarchy per thread (see cache.c), so a worker simulates one
+   configuration at a time with the exported cache interface, exactly as
+   cachesim does, and frees it before taking the next.
+
+   Configurations are dealt round robin to per-worker deques. A worker
+   takes from the back of its own deque and, once that is empty, steals
+   from the front of the others', so one slow configuration (OPT, a large
+   LRU level) does not leave the other workers idle at the end.
+
+   usage: cachesweep [-j threads] trace config... */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "cache-model.h"
+#include "trace.h"
+
+typedef struct SweepRow {
+	char name[20];
+	long long accessCount;
+	long long hitCount;
+	bool opt;
+	bool optTruncated;
+	Result optResult;
+} SweepRow;
+
+typedef struct SweepTask {
+	char* config;
+	SweepRow* rows;
+	int numberOfRows;
+	SweepRow total;
+	long long references;
+	long long stallCycles;
+} SweepTask;
+
+/* Task indices dealt to one worker; the owner pops at tail, thieves at
+   head. */
+typedef struct WorkQueue {
+	pthread_mutex_t lock;
+	int* tasks;
+	int head;
+	int tail;
+} WorkQueue;
+
+typedef struct Worker {
+	int id;
+	pthread_t thread;
+	long long tasksDone;
+	long long tasksStolen;
+} Worker;
+
+static TraceReader* trace;
+static SweepTask* tasks;
+static WorkQueue* queues;
+static int numberOfWorkers;
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int popTask(WorkQueue* queue) {
+	int task = -1;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->head < queue->tail) {
+		queue->tail -= 1;
+		task = queue->tasks[queue->tail];
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return task;
+}
+
+static int stealTask(WorkQueue* queue) {
+	int task = -1;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->head < queue->tail) {
+		task = queue->tasks[queue->head];
+		queue->head += 1;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return task;
+}
+
+static void collectResult(SweepTask* task, Cache* cache) {
+	SweepRow* row = &task->rows[task->numberOfRows++];
+	Result result = estimatedResult(cache);
+
+	snprintf(row->name, sizeof(row->name), "%s", cache->name);
+	row->accessCount = result.accessCount;
+	row->hitCount = result.hitCount;
+	row->opt = cache->optTrace != NULL;
+	row->optTruncated = false;
+	if (row->opt) {
+		row->optTruncated = cache->optTrace->truncated;
+		row->optResult = simulateOpt(cache);
+	}
+}
+
+/* Same totals as print_cache_result: the accesses of level 1 against the
+   hits of all levels. */
+static void runTask(SweepTask* task) {
+	TraceReader* reader = openTraceView(trace);
+	TraceBatch* batch = &reader->batch;
+	int i;
+
+	set_cache_config_file(task->config);
+	while (readTraceBatch(reader) > 0) {
+		for (i = 0; i < batch->count; i++) {
+			switch (batch->kinds[i]) {
+			case TRACE_INST:
+				task->stallCycles += instruction_load(batch->addrs[i]);
+				break;
+			case TRACE_LOAD:
+				task->stallCycles += data_load(batch->addrs[i], batch->pcs[i]);
+				break;
+			case TRACE_STORE:
+				task->stallCycles += data_store(batch->addrs[i], batch->pcs[i]);
+				break;
+			}
+		}
+		task->references += batch->count;
+	}
+	closeTraceReader(reader);
+
+	// an empty trace never touched the cache
+	nonblocking_data_cache();
+	task->rows = (SweepRow *) malloc(sizeof(SweepRow) * 2 * cacheSystem.numberOfLevels);
+	snprintf(task->total.name, sizeof(task->total.name), "total");
+	task->total.accessCount = estimatedResult(cacheSystem.L1InstructionCache).accessCount;
+	if (cacheSystem.levels[0].split) {
+		task->total.accessCount += estimatedResult(cacheSystem.L1DataCache).accessCount;
+	}
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			collectResult(task, level->instructionCache);
+			task->total.hitCount += task->rows[task->numberOfRows - 1].hitCount;
+		}
+		collectResult(task, level->dataCache);
+		task->total.hitCount += task->rows[task->numberOfRows - 1].hitCount;
+	}
+	free_cache_system();
+}
+
+static void* runWorker(void* arg) {
+	Worker* worker = (Worker *) arg;
+	int task;
+	int i;
+
+	for (;;) {
+		task = popTask(&queues[worker->id]);
+		// no task is added after the start, so once every deque is empty the sweep is done
+		for (i = 1; task < 0 && i < numberOfWorkers; i++) {
+			task = stealTask(&queues[(worker->id + i) % numberOfWorkers]);
+			worker->tasksStolen += task >= 0;
+		}
+		if (task < 0) {
+			return NULL;
+		}
+		runTask(&tasks[task]);
+		worker->tasksDone += 1;
+	}
+}
+
+static void printRow(SweepTask* task, SweepRow* row) {
+	Result* opt = &row->optResult;
+
+	printf("%s,%s,%lld,%lld,%lld,%0.6f,%lld", task->config, row->name, row->accessCount, row->hitCount,
+		row->accessCount - row->hitCount, row->accessCount ? (double) row->hitCount / row->accessCount : 0.0,
+		task->stallCycles);
+	if (row->opt) {
+		printf(",%lld,%lld,%0.6f\n", opt->hitCount, opt->accessCount - opt->hitCount,
+			opt->accessCount ? (double) opt->hitCount / opt->accessCount : 0.0);
+	} else {
+		printf(",,,\n");
+	}
+}
+
+int main(int argc, char** argv) {
+	int numberOfTasks;
+	int first = 1;
+	int i, j;
+	long long references = 0;
+
+	numberOfWorkers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+		numberOfWorkers = atoi(argv[2]);
+		first = 3;
+	}
+	if (argc - first < 2 || numberOfWorkers < 1) {
+		printf("usage: cachesweep [-j threads] trace config...\n");
+		return 1;
+	}
+
+	trace = openTraceReader(argv[first]);
+	numberOfTasks = argc - first - 1;
+	if (numberOfWorkers > numberOfTasks) {
+		numberOfWorkers = numberOfTasks;
+	}
+	tasks = (SweepTask *) calloc(numberOfTasks, sizeof(SweepTask));
+	for (i = 0; i < numberOfTasks; i++) {
+		tasks[i].config = argv[first + 1 + i];
+	}
+
+	queues = (WorkQueue *) calloc(numberOfWorkers, sizeof(WorkQueue));
+	for (i = 0; i < numberOfWorkers; i++) {
+		pthread_mutex_init(&queues[i].lock, NULL);
+		queues[i].tasks = (int *) malloc(sizeof(int) * numberOfTasks);
+	}
+	for (i = 0; i < numberOfTasks; i++) {
+		WorkQueue* queue = &queues[i % numberOfWorkers];
+		queue->tasks[queue->tail++] = i;
+	}
+
+	Worker* workers = (Worker *) calloc(numberOfWorkers, sizeof(Worker));
+	double start = now();
+	for (i = 0; i < numberOfWorkers; i++) {
+		workers[i].id = i;
+		if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0) {
+			printf("Cannot start worker %d\n", i);
+			return 1;
+		}
+	}
+	for (i = 0; i < numberOfWorkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	double elapsed = now() - start;
+
+	printf("config,cache,accesses,hits,misses,hit_ratio,stall_cycles,opt_hits,opt_misses,opt_hit_ratio\n");
+	for (i = 0; i < numberOfTasks; i++) {
+		for (j = 0; j < tasks[i].numberOfRows; j++) {
+			printRow(&tasks[i], &tasks[i].rows[j]);
+		}
+		printRow(&tasks[i], &tasks[i].total);
+	}
+
+	for (i = 0; i < numberOfTasks; i++) {
+		references += tasks[i].references;
+	}
+	closeTraceReader(trace);
+
+	fprintf(stderr, "\nConfigurations: %d, Workers: %d\n", numberOfTasks, numberOfWorkers);
+	for (i = 0; i < numberOfTasks; i++) {
+		for (j = 0; j < tasks[i].numberOfRows; j++) {
+			if (tasks[i].rows[j].opt && tasks[i].rows[j].optTruncated) {
+				fprintf(stderr, "OPT of %s in %s only covers the first %lld references\n",
+					tasks[i].rows[j].name, tasks[i].config, tasks[i].rows[j].optResult.accessCount);
+			}
+		}
+	}
+	for (i = 0; i < numberOfWorkers; i++) {
+		fprintf(stderr, "Worker %d: %lld configurations (%lld stolen)\n", i, workers[i].tasksDone, workers[i].tasksStolen);
+	}
+	fprintf(stderr, "Elapsed: %0.3f s\n", elapsed);
+	fprintf(stderr, "References per second: %0.0f\n", references / elapsed);
+	return 0;
+}
@@ -0,0 +1,141 @@
+/* Interval statistics (see interval-stats.h). The run loop counts
+   instructions into intervalStats; this file turns the counters into
+   rows. The cache counts are read from the hierarchy of the run loop's
+   thread. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache-model.h"
+#include "interval-stats.h"
+
+IntervalStats* intervalStats = NULL;
+
+void open_interval_stats(char* path, char* period) {
+	IntervalStats* stats = (IntervalStats *) calloc(1, sizeof(IntervalStats));
+	char* end;
+	size_t length = strlen(path);
+
+	stats->period = strtoll(period, &end, 10);
+	stats->byCycles = *end == 'c';
+	if (stats->period <= 0 || (*end != '\0' && strcmp(end, "c") != 0)) {
+		printf("The interval %s is not a number of instructions (n) or cycles (nc)\n", period);
+		exit(1);
+	}
+	stats->file = fopen(path, "w");
+	if (stats->file == NULL) {
+		printf("Cannot open the interval file %s\n", path);
+		exit(1);
+	}
+	stats->buffer = (char *) malloc(INTERVAL_BUFFER_SIZE);
+	setvbuf(stats->file, stats->buffer, _IOFBF, INTERVAL_BUFFER_SIZE);
+	stats->json = length > 6 && strcmp(path + length - 6, ".jsonl") == 0;
+	stats->nextBoundary = stats->period;
+
+	intervalStats = stats;
+	atexit(close_interval_stats);
+}
+
+/* Caches in report order; run_spim has built the hierarchy before the
+   first instruction. */
+static void writeHeader(IntervalStats* stats) {
+	int i;
+
+	stats->headerWritten = true;
+	for (i = 0; i < cacheSystem.numberOfLevels; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split && stats->numberOfCaches < MAX_INTERVAL_CACHES) {
+			strcpy(stats->names[stats->numberOfCaches++], level->instructionCache->name);
+		}
+		if (stats->numberOfCaches < MAX_INTERVAL_CACHES) {
+			strcpy(stats->names[stats->numberOfCaches++], level->dataCache->name);
+		}
+	}
+	if (stats->json) {
+		return;
+	}
+	fprintf(stats->file, "instructions,cycles,memory_stall_cycles,data_hazard_stalls,branch_stalls");
+	for (i = 0; i < stats->numberOfCaches; i++) {
+		fprintf(stats->file, ",%s_hits,%s_misses", stats->names[i], stats->names[i]);
+	}
+	fprintf(stats->file, "\n");
+}
+
+static void readCounters(IntervalStats* stats, IntervalCounters* counters) {
+	int count = 0;
+	int i;
+
+	counters->instructions = stats->instructions;
+	counters->cycles = stats->cycles;
+	counters->memoryStalls = cacheSystem.stallCycles;
+	counters->dataStalls = stats->dataStalls;
+	counters->branchStalls = stats->branchStalls;
+	for (i = 0; i < cacheSystem.numberOfLevels && count < stats->numberOfCaches; i++) {
+		CacheLevel* level = &cacheSystem.levels[i];
+		if (level->split) {
+			counters->hits[count] = level->instructionCache->result.hitCount;
+			counters->misses[count++] = level->instructionCache->result.accessCount - level->instructionCache->result.hitCount;
+		}
+		if (count < stats->numberOfCaches) {
+			counters->hits[count] = level->dataCache->result.hitCount;
+			counters->misses[count++] = level->dataCache->result.accessCount - level->dataCache->result.hitCount;
+		}
+	}
+}
+
+/* One row of the differences to the previous interval. */
+static void writeRow(IntervalStats* stats) {
+	IntervalCounters now;
+	IntervalCounters* last = &stats->last;
+	int i;
+
+	if (!stats->headerWritten) {
+		writeHeader(stats);
+	}
+	readCounters(stats, &now);
+	if (stats->json) {
+		fprintf(stats->file, "{\"instructions\":%lld,\"cycles\":%lld,\"memory_stall_cycles\":%lld,\"data_hazard_stalls\":%lld,\"branch_stalls\":%lld",
+			now.instructions - last->instructions, now.cycles - last->cycles, now.memoryStalls - last->memoryStalls,
+			now.dataStalls - last->dataStalls, now.branchStalls - last->branchStalls);
+		for (i = 0; i < stats->numberOfCaches; i++) {
+			fprintf(stats->file, ",\"%s\":{\"hits\":%lld,\"misses\":%lld}", stats->names[i],
+				now.hits[i] - last->hits[i], now.misses[i] - last->misses[i]);
+		}
+		fprintf(stats->file, "}\n");
+	} else {
+		fprintf(stats->file, "%lld,%lld,%lld,%lld,%lld", now.instructions - last->instructions, now.cycles - last->cycles,
+			now.memoryStalls - last->memoryStalls, now.dataStalls - last->dataStalls, now.branchStalls - last->branchStalls);
+		for (i = 0; i < stats->numberOfCaches; i++) {
+			fprintf(stats->file, ",%lld,%lld", now.hits[i] - last->hits[i], now.misses[i] - last->misses[i]);
+		}
+		fprintf(stats->file, "\n");
+	}
+	*last = now;
+}
+
+/* A long stall can cross several cycle boundaries at once; they all end
+   in this row. */
+void writeInterval(IntervalStats* stats) {
+	long long position = stats->byCycles ? stats->cycles : stats->instructions;
+
+	writeRow(stats);
+	while (stats->nextBoundary <= position) {
+		stats->nextBoundary += stats->period;
+	}
+}
+
+void close_interval_stats() {
+	IntervalStats* stats = intervalStats;
+
+	if (stats == NULL) {
+		return;
+	}
+	if (stats->instructions > stats->last.instructions) {
+		writeRow(stats);
+	}
+	fclose(stats->file);
+	free(stats->buffer);
+	free(stats);
+	intervalStats = NULL;
+}
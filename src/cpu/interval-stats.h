@@ -0,0 +1,68 @@
+
+#ifndef __interval_stats__
+#define __interval_stats__
+
+#include <stdio.h>
+
+/* Time series of the run for phase analysis (spim -intervals).
+   Every period instructions, or period cycles when the period ends in
+   'c', one row is appended with what happened in that interval: the
+   instructions and cycles, the stall cycles returned by the cache
+   interface, the data hazard and branch stalls of the pipeline, and the
+   hits and misses of every cache. The last, partial interval is written
+   at exit.
+
+   Rows are CSV with a header line, or JSON lines when the file name ends
+   in .jsonl. The file is written through a large stdio buffer, so the
+   run loop only pays for a counter and a compare per instruction. */
+
+#define INTERVAL_BUFFER_SIZE (1 << 20)
+#define MAX_INTERVAL_CACHES 16
+
+typedef struct IntervalCounters {
+	long long instructions;
+	long long cycles;
+	long long memoryStalls;
+	long long dataStalls;
+	long long branchStalls;
+	long long hits[MAX_INTERVAL_CACHES];
+	long long misses[MAX_INTERVAL_CACHES];
+} IntervalCounters;
+
+typedef struct IntervalStats {
+	FILE* file;
+	char* buffer;
+	bool json;
+	bool byCycles;
+	long long period;
+	long long nextBoundary;
+	long long instructions;
+	int cycles;	// run loop counters at the last instruction
+	int dataStalls;
+	int branchStalls;
+	bool headerWritten;
+	int numberOfCaches;
+	char names[MAX_INTERVAL_CACHES][20];
+	IntervalCounters last;	// totals at the end of the previous interval
+} IntervalStats;
+
+/* Exported functions for interval statistics */
+void open_interval_stats(char* path, char* period);	// write a row every period instructions ("n") or cycles ("nc") to path
+void close_interval_stats();		// write the last interval and close the file, if any
+
+extern IntervalStats* intervalStats;
+
+void writeInterval(IntervalStats* stats);	// ends the current interval
+
+/* Called by the run loop once per instruction with its counters. */
+static inline void countIntervalInstruction(IntervalStats* stats, int cycles, int dataStalls, int branchStalls) {
+	stats->instructions += 1;
+	stats->cycles = cycles;
+	stats->dataStalls = dataStalls;
+	stats->branchStalls = branchStalls;
+	if ((stats->byCycles ? cycles : stats->instructions) >= stats->nextBoundary) {
+		writeInterval(stats);
+	}
+}
+
+#endif
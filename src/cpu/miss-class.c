@@ -0,0 +1,161 @@
+/* Three-C miss classification (see miss-class.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "miss-class.h"
+
+MissClassifier* createMissClassifier(int numberOfLines, int lineShift) {
+	MissClassifier* classifier = (MissClassifier *) calloc(1, sizeof(MissClassifier));
+	unsigned int numberOfBuckets = 1;
+	int i;
+
+	classifier->numberOfPages = ((1ull << (32 - lineShift)) + (1u << FIRST_TOUCH_PAGE_BITS) - 1) >> FIRST_TOUCH_PAGE_BITS;
+	classifier->touched = (unsigned char **) calloc(classifier->numberOfPages, sizeof(unsigned char *));
+
+	while (numberOfBuckets < 2 * (unsigned int) numberOfLines) {
+		numberOfBuckets *= 2;
+	}
+	classifier->capacity = numberOfLines;
+	classifier->lines = (unsigned int *) malloc(sizeof(unsigned int) * numberOfLines);
+	classifier->prev = (int *) malloc(sizeof(int) * numberOfLines);
+	classifier->next = (int *) malloc(sizeof(int) * numberOfLines);
+	classifier->chain = (int *) malloc(sizeof(int) * numberOfLines);
+	classifier->buckets = (int *) malloc(sizeof(int) * numberOfBuckets);
+	classifier->bucketMask = numberOfBuckets - 1;
+	for (i = 0; i < (int) numberOfBuckets; i++) {
+		classifier->buckets[i] = SHADOW_NO_LINE;
+	}
+	classifier->head = SHADOW_NO_LINE;
+	classifier->tail = SHADOW_NO_LINE;
+	return classifier;
+}
+
+void freeMissClassifier(MissClassifier* classifier) {
+	unsigned int i;
+
+	for (i = 0; i < classifier->numberOfPages; i++) {
+		free(classifier->touched[i]);
+	}
+	free(classifier->touched);
+	free(classifier->lines);
+	free(classifier->prev);
+	free(classifier->next);
+	free(classifier->chain);
+	free(classifier->buckets);
+	free(classifier);
+}
+
+/* Marks line as referenced; true when it was not before. */
+static bool touchFirst(MissClassifier* classifier, unsigned int line) {
+	unsigned char** page = &classifier->touched[line >> FIRST_TOUCH_PAGE_BITS];
+	unsigned int bit = line & ((1u << FIRST_TOUCH_PAGE_BITS) - 1);
+	unsigned char mask = 1 << (bit & 7);
+
+	if (*page == NULL) {
+		*page = (unsigned char *) calloc(1 << (FIRST_TOUCH_PAGE_BITS - 3), 1);
+	}
+	if ((*page)[bit >> 3] & mask) {
+		return false;
+	}
+	(*page)[bit >> 3] |= mask;
+	return true;
+}
+
+static unsigned int bucketOf(MissClassifier* classifier, unsigned int line) {
+	return (line * 2654435761u) & classifier->bucketMask;
+}
+
+static void unlinkNode(MissClassifier* classifier, int node) {
+	if (classifier->prev[node] != SHADOW_NO_LINE) {
+		classifier->next[classifier->prev[node]] = classifier->next[node];
+	} else {
+		classifier->head = classifier->next[node];
+	}
+	if (classifier->next[node] != SHADOW_NO_LINE) {
+		classifier->prev[classifier->next[node]] = classifier->prev[node];
+	} else {
+		classifier->tail = classifier->prev[node];
+	}
+}
+
+static void pushFront(MissClassifier* classifier, int node) {
+	classifier->prev[node] = SHADOW_NO_LINE;
+	classifier->next[node] = classifier->head;
+	if (classifier->head != SHADOW_NO_LINE) {
+		classifier->prev[classifier->head] = node;
+	} else {
+		classifier->tail = node;
+	}
+	classifier->head = node;
+}
+
+static void unhashNode(MissClassifier* classifier, int node) {
+	int* link = &classifier->buckets[bucketOf(classifier, classifier->lines[node])];
+
+	while (*link != node) {
+		link = &classifier->chain[*link];
+	}
+	*link = classifier->chain[node];
+}
+
+/* References line in the shadow cache; true on a hit. A miss evicts the
+   least recently used line once the cache is full. */
+static bool accessShadow(MissClassifier* classifier, unsigned int line) {
+	int* bucket = &classifier->buckets[bucketOf(classifier, line)];
+	int node;
+
+	for (node = *bucket; node != SHADOW_NO_LINE; node = classifier->chain[node]) {
+		if (classifier->lines[node] == line) {
+			if (node != classifier->head) {
+				unlinkNode(classifier, node);
+				pushFront(classifier, node);
+			}
+			return true;
+		}
+	}
+
+	if (classifier->count < classifier->capacity) {
+		node = classifier->count++;
+	} else {
+		node = classifier->tail;
+		unlinkNode(classifier, node);
+		unhashNode(classifier, node);
+	}
+	classifier->lines[node] = line;
+	classifier->chain[node] = *bucket;
+	*bucket = node;
+	pushFront(classifier, node);
+	return false;
+}
+
+/* Every reference to the cache goes through here, hits included, so that
+   the first-touch bitmap and the shadow cache see the whole stream. */
+void classifyAccess(MissClassifier* classifier, unsigned int line, bool hit) {
+	bool first = touchFirst(classifier, line);
+	bool shadowHit = accessShadow(classifier, line);
+
+	if (hit) {
+		return;
+	}
+	if (first) {
+		classifier->classes.compulsory += 1;
+	} else if (!shadowHit) {
+		classifier->classes.capacity += 1;
+	} else {
+		classifier->classes.conflict += 1;
+	}
+}
+
+/* scale extrapolates the counts of sampled sets to all of them. */
+void printMissClasses(const char* name, MissClassifier* classifier, double scale) {
+	MissClasses* classes = &classifier->classes;
+	long long misses = classes->compulsory + classes->capacity + classes->conflict;
+
+	printf("Miss Classes of %s\n", name);
+	printf("Compulsory: %lld (%0.3f), Capacity: %lld (%0.3f), Conflict: %lld (%0.3f)\n",
+		llround(classes->compulsory * scale), misses ? (float) classes->compulsory / misses : 0.0,
+		llround(classes->capacity * scale), misses ? (float) classes->capacity / misses : 0.0,
+		llround(classes->conflict * scale), misses ? (float) classes->conflict / misses : 0.0);
+}
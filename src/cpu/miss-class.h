@@ -0,0 +1,44 @@
+
+#ifndef __miss_class__
+#define __miss_class__
+
+/* Three-C classification of the misses of one cache (3C).
+   A miss is compulsory when its line was never referenced before,
+   capacity when a fully associative LRU cache of the same number of
+   lines would have missed too, and conflict otherwise. The first
+   references are kept in a bitmap over all line numbers, allocated a
+   page at a time as lines are touched; the fully associative cache is a
+   shadow of the line numbers only, an LRU list with a hash index. */
+
+#define FIRST_TOUCH_PAGE_BITS 15	// lines per bitmap page, 4 KB of bits
+#define SHADOW_NO_LINE -1
+
+typedef struct MissClasses {
+	long long compulsory;
+	long long capacity;
+	long long conflict;
+} MissClasses;
+
+typedef struct MissClassifier {
+	unsigned char** touched;	// first-touch bitmap pages, NULL until a line in them is referenced
+	unsigned int numberOfPages;
+	// shadow cache: node i holds lines[i], linked from most (head) to least (tail) recently used
+	unsigned int* lines;
+	int* prev;
+	int* next;
+	int* chain;	// next node in the same hash bucket
+	int* buckets;
+	unsigned int bucketMask;
+	int head;
+	int tail;
+	int count;
+	int capacity;
+	MissClasses classes;
+} MissClassifier;
+
+MissClassifier* createMissClassifier(int numberOfLines, int lineShift);	// lineShift: address bits below the line number
+void freeMissClassifier(MissClassifier* classifier);
+void classifyAccess(MissClassifier* classifier, unsigned int line, bool hit);
+void printMissClasses(const char* name, MissClassifier* classifier, double scale);
+
+#endif
@@ -0,0 +1,87 @@
+/* Miss status holding registers. The file is small (a handful of entries
+   per level), so allocation and lookup just scan it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mshr.h"
+
+void createMSHRFile(MSHRFile* file, int count) {
+	memset(file, 0, sizeof(MSHRFile));
+	file->count = count;
+	if (count > 0) {
+		file->entries = (MSHR *) calloc(count, sizeof(MSHR));
+	}
+}
+
+void freeMSHRFile(MSHRFile* file) {
+	free(file->entries);
+	file->entries = NULL;
+}
+
+/* Picks a free entry for a primary miss at cycle now. When all entries are
+   busy the miss waits for the one that completes first, and the returned
+   start cycle is later than now. */
+long long allocateMSHR(MSHRFile* file, long long now, int* entry) {
+	int i;
+	int busy = 0;
+	int earliest = 0;
+
+	*entry = -1;
+	for (i = 0; i < file->count; i++) {
+		if (file->entries[i].readyCycle > now) {
+			busy += 1;
+			if (file->entries[i].readyCycle < file->entries[earliest].readyCycle) {
+				earliest = i;
+			}
+		} else if (*entry < 0) {
+			*entry = i;
+		}
+	}
+
+	file->primaryMisses += 1;
+	file->occupancySum += busy;
+	if (busy < file->count && busy + 1 > file->peakOccupancy) {
+		file->peakOccupancy = busy + 1;
+	} else if (busy > file->peakOccupancy) {
+		file->peakOccupancy = busy;
+	}
+
+	if (*entry >= 0) {
+		return now;
+	}
+	*entry = earliest;
+	file->fullStalls += 1;
+	file->fullStallCycles += file->entries[earliest].readyCycle - now;
+	return file->entries[earliest].readyCycle;
+}
+
+void fillMSHR(MSHRFile* file, int entry, unsigned int line, long long start, long long readyCycle) {
+	file->entries[entry].line = line;
+	file->entries[entry].readyCycle = readyCycle;
+	file->busyCycles += readyCycle - start;
+	if (readyCycle > file->lastReadyCycle) {
+		file->lastReadyCycle = readyCycle;
+	}
+}
+
+/* Average occupancy is the number of entries in flight averaged over the
+   whole run (cycles, or until the last fill if that is later). */
+void printMSHRStats(const char* name, MSHRFile* file, long long cycles) {
+	long long misses = file->primaryMisses + file->secondaryMisses;
+
+	if (file->count == 0) {
+		return;
+	}
+	if (file->lastReadyCycle > cycles) {
+		cycles = file->lastReadyCycle;
+	}
+	printf("MSHR of %s (%d entries)\n", name, file->count);
+	printf("Primary Misses: %lld, Merged Secondary Misses: %lld (%0.3f)\n",
+		file->primaryMisses, file->secondaryMisses, misses ? (float) file->secondaryMisses / misses : 0.0);
+	printf("Full Stalls: %lld (%lld cycles)\n", file->fullStalls, file->fullStallCycles);
+	printf("Occupancy: peak %d, average %0.3f, seen by a miss %0.3f\n",
+		file->peakOccupancy, cycles ? (float) file->busyCycles / cycles : 0.0,
+		file->primaryMisses ? (float) file->occupancySum / file->primaryMisses : 0.0);
+}
@@ -0,0 +1,48 @@
+
+#ifndef __mshr__
+#define __mshr__
+
+/* Miss status holding registers of a non-blocking cache.
+   Every entry tracks one line in flight and the cycle it arrives. An entry
+   is free again once that cycle has passed, so the file needs no explicit
+   retirement. A miss to a line that is already in flight (a secondary
+   miss) merges into its entry instead of going to the next level. */
+
+typedef struct MSHR {
+	unsigned int line;
+	long long readyCycle;
+} MSHR;
+
+typedef struct MSHRFile {
+	int count;
+	MSHR* entries;
+	long long primaryMisses;
+	long long secondaryMisses;
+	long long fullStalls;
+	long long fullStallCycles;
+	long long busyCycles;
+	long long occupancySum;
+	long long lastReadyCycle;
+	int peakOccupancy;
+} MSHRFile;
+
+void createMSHRFile(MSHRFile* file, int count);
+void freeMSHRFile(MSHRFile* file);
+long long allocateMSHR(MSHRFile* file, long long now, int* entry);	// cycle the miss can be sent
+void fillMSHR(MSHRFile* file, int entry, unsigned int line, long long start, long long readyCycle);
+void printMSHRStats(const char* name, MSHRFile* file, long long cycles);
+
+/* Returns the entry holding line while it is in flight at cycle now,
+   or -1. */
+static inline int findMSHR(MSHRFile* file, unsigned int line, long long now) {
+	int i;
+
+	for (i = 0; i < file->count; i++) {
+		if (file->entries[i].line == line && file->entries[i].readyCycle > now) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/* Trace capture and next-use computation for the OPT bound.
+   The next use of every reference comes from one backward pass over the
+   trace with a hash table from line number to the position where it was
+   last seen, so the whole computation is O(n). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opt.h"
+
+#define INITIAL_TRACE_CAPACITY (1 << 16)
+#define MAX_TRACE_LENGTH 0xfffffffeu
+
+OptTrace* createOptTrace() {
+	OptTrace* trace = (OptTrace *) malloc(sizeof(OptTrace));
+
+	trace->capacity = INITIAL_TRACE_CAPACITY;
+	trace->length = 0;
+	trace->lines = (unsigned int *) malloc(sizeof(unsigned int) * trace->capacity);
+	trace->truncated = false;
+	return trace;
+}
+
+void freeOptTrace(OptTrace* trace) {
+	free(trace->lines);
+	free(trace);
+}
+
+void growOptTrace(OptTrace* trace) {
+	unsigned int capacity;
+
+	if (trace->capacity >= MAX_TRACE_LENGTH) {
+		trace->truncated = true;
+		return;
+	}
+	capacity = trace->capacity > MAX_TRACE_LENGTH / 2 ? MAX_TRACE_LENGTH : trace->capacity * 2;
+	unsigned int* lines = (unsigned int *) realloc(trace->lines, sizeof(unsigned int) * (size_t) capacity);
+	if (lines == NULL) {
+		trace->truncated = true;
+		return;
+	}
+	trace->lines = lines;
+	trace->capacity = capacity;
+}
+
+/* Open-addressing table from line number + 1 (0 marks an empty slot) to the
+   position of its most recent reference. */
+typedef struct LastUseTable {
+	unsigned int* keys;
+	unsigned int* positions;
+	unsigned int mask;
+	unsigned int count;
+} LastUseTable;
+
+static void createLastUseTable(LastUseTable* table, unsigned int size) {
+	table->keys = (unsigned int *) calloc(size, sizeof(unsigned int));
+	table->positions = (unsigned int *) malloc(sizeof(unsigned int) * size);
+	table->mask = size - 1;
+	table->count = 0;
+}
+
+static inline unsigned int hashLine(unsigned int line) {
+	return line * 2654435761u;
+}
+
+/* Returns the slot of key, claiming an empty one if it is not present. */
+static unsigned int findSlot(LastUseTable* table, unsigned int key) {
+	unsigned int slot = hashLine(key) & table->mask;
+
+	while (table->keys[slot] != 0 && table->keys[slot] != key) {
+		slot = (slot + 1) & table->mask;
+	}
+	return slot;
+}
+
+static void growLastUseTable(LastUseTable* table) {
+	LastUseTable bigger;
+	unsigned int i;
+
+	createLastUseTable(&bigger, (table->mask + 1) * 2);
+	for (i = 0; i <= table->mask; i++) {
+		if (table->keys[i] != 0) {
+			unsigned int slot = findSlot(&bigger, table->keys[i]);
+			bigger.keys[slot] = table->keys[i];
+			bigger.positions[slot] = table->positions[i];
+		}
+	}
+	bigger.count = table->count;
+	free(table->keys);
+	free(table->positions);
+	*table = bigger;
+}
+
+unsigned int* computeNextUse(OptTrace* trace) {
+	LastUseTable table;
+	unsigned int i;
+	unsigned int* nextUse = (unsigned int *) malloc(sizeof(unsigned int) * (size_t) (trace->length + 1));
+
+	createLastUseTable(&table, 1 << 12);
+	for (i = trace->length; i-- > 0; ) {
+		unsigned int key = trace->lines[i] + 1;
+		unsigned int slot = findSlot(&table, key);
+
+		if (table.keys[slot] == 0) {
+			table.keys[slot] = key;
+			table.count += 1;
+			nextUse[i] = NEVER_USED_AGAIN;
+		} else {
+			nextUse[i] = table.positions[slot];
+		}
+		table.positions[slot] = i;
+
+		if (table.count * 2 > table.mask) {
+			growLastUseTable(&table);
+		}
+	}
+
+	free(table.keys);
+	free(table.positions);
+	return nextUse;
+}
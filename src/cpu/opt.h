@@ -0,0 +1,34 @@
+
+#ifndef __opt__
+#define __opt__
+
+/* Belady's optimal replacement (OPT) as an upper bound for a level.
+   While the program runs, every level records the line numbers it is
+   asked for; at exit the recorded stream is replayed through a cache of
+   the same geometry that always evicts the line used furthest in the
+   future. */
+
+#define NEVER_USED_AGAIN 0xffffffffu
+
+typedef struct OptTrace {
+	unsigned int* lines;
+	unsigned int length;
+	unsigned int capacity;
+	bool truncated;
+} OptTrace;
+
+OptTrace* createOptTrace();
+void freeOptTrace(OptTrace* trace);
+void growOptTrace(OptTrace* trace);
+
+static inline void recordOptReference(OptTrace* trace, unsigned int line) {
+	if (trace->length == trace->capacity) {
+		growOptTrace(trace);
+		if (trace->truncated) return;
+	}
+	trace->lines[trace->length++] = line;
+}
+
+unsigned int* computeNextUse(OptTrace* trace);	// next position of each reference, or NEVER_USED_AGAIN
+
+#endif
@@ -0,0 +1,92 @@
+/* Per-PC hit and miss counts (see pc-profile.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pc-profile.h"
+
+static PCCount* allocateCounts(unsigned int capacity) {
+	PCCount* counts = (PCCount *) calloc(capacity, sizeof(PCCount));
+	unsigned int i;
+
+	for (i = 0; i < capacity; i++) {
+		counts[i].pc = PC_PROFILE_EMPTY;
+	}
+	return counts;
+}
+
+PCProfile* createPCProfile() {
+	PCProfile* profile = (PCProfile *) calloc(1, sizeof(PCProfile));
+
+	profile->capacity = PC_PROFILE_MIN_CAPACITY;
+	profile->counts = allocateCounts(profile->capacity);
+	return profile;
+}
+
+void freePCProfile(PCProfile* profile) {
+	free(profile->counts);
+	free(profile);
+}
+
+void growPCProfile(PCProfile* profile) {
+	PCCount* old = profile->counts;
+	unsigned int oldCapacity = profile->capacity;
+	unsigned int i;
+
+	profile->capacity *= 2;
+	profile->counts = allocateCounts(profile->capacity);
+	for (i = 0; i < oldCapacity; i++) {
+		if (old[i].pc != PC_PROFILE_EMPTY) {
+			unsigned int slot = hashPC(old[i].pc, profile->capacity);
+			while (profile->counts[slot].pc != PC_PROFILE_EMPTY) {
+				slot = (slot + 1) & (profile->capacity - 1);
+			}
+			profile->counts[slot] = old[i];
+		}
+	}
+	free(old);
+}
+
+// most misses first, ties by address so the report is stable
+static int compareMisses(const void* a, const void* b) {
+	const PCCount* x = (const PCCount *) a;
+	const PCCount* y = (const PCCount *) b;
+
+	if (x->misses != y->misses) {
+		return x->misses > y->misses ? -1 : 1;
+	}
+	return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+/* The top PCs by misses with their share of all misses of the cache.
+   PCs without misses are left out. */
+void printPCProfile(const char* name, PCProfile* profile, int top, PCDescriber describe) {
+	PCCount* counts = (PCCount *) malloc(sizeof(PCCount) * (profile->size + 1));
+	long long totalMisses = 0;
+	int size = 0;
+	unsigned int slot;
+	int i;
+
+	for (slot = 0; slot < profile->capacity; slot++) {
+		if (profile->counts[slot].pc != PC_PROFILE_EMPTY) {
+			counts[size++] = profile->counts[slot];
+			totalMisses += profile->counts[slot].misses;
+		}
+	}
+	qsort(counts, size, sizeof(PCCount), compareMisses);
+
+	printf("Misses by PC of %s (%d PCs)\n", name, size);
+	for (i = 0; i < size && i < top && counts[i].misses > 0; i++) {
+		PCCount* count = &counts[i];
+		char* description = describe != NULL ? describe(count->pc) : NULL;
+
+		printf("0x%08x: %lld misses (%0.3f), %lld hits", count->pc, count->misses,
+			(float) count->misses / totalMisses, count->hits);
+		if (description != NULL) {
+			printf("  %s", description);
+			free(description);
+		}
+		printf("\n");
+	}
+	free(counts);
+}
@@ -0,0 +1,64 @@
+
+#ifndef __pc_profile__
+#define __pc_profile__
+
+/* Per-PC attribution of the hits and misses of a cache (PROFILE).
+   The counts are kept in an open-addressing hash map keyed by the PC of
+   the instruction that made the access: a fetch counts against its own
+   address, a load or store against the PC passed to data_load or
+   data_store, and the lower levels see the PC of the access that missed
+   into them. With SAMPLE only the sampled sets are counted. */
+
+#define PC_PROFILE_EMPTY 0xffffffffu	// instructions are word aligned, so no PC has this value
+#define PC_PROFILE_MIN_CAPACITY 256
+
+typedef struct PCCount {
+	unsigned int pc;
+	long long misses;
+	long long hits;
+} PCCount;
+
+typedef struct PCProfile {
+	PCCount* counts;
+	unsigned int capacity;	// power of two
+	unsigned int size;
+} PCProfile;
+
+/* Text for a PC in the report, e.g. its label and disassembly, as a
+   malloc'd string that the report frees, or NULL. */
+typedef char* (*PCDescriber)(unsigned int pc);
+
+PCProfile* createPCProfile();
+void freePCProfile(PCProfile* profile);
+void growPCProfile(PCProfile* profile);
+void printPCProfile(const char* name, PCProfile* profile, int top, PCDescriber describe);
+
+static inline unsigned int hashPC(unsigned int pc, unsigned int capacity) {
+	return ((pc >> 2) * 2654435761u) & (capacity - 1);
+}
+
+static inline void recordPCAccess(PCProfile* profile, unsigned int pc, bool hit) {
+	unsigned int slot = hashPC(pc, profile->capacity);
+
+	while (profile->counts[slot].pc != pc) {
+		if (profile->counts[slot].pc == PC_PROFILE_EMPTY) {
+			// kept at most half full so that probes stay short
+			if (2 * (profile->size + 1) > profile->capacity) {
+				growPCProfile(profile);
+				recordPCAccess(profile, pc, hit);
+				return;
+			}
+			profile->counts[slot].pc = pc;
+			profile->size += 1;
+			break;
+		}
+		slot = (slot + 1) & (profile->capacity - 1);
+	}
+	if (hit) {
+		profile->counts[slot].hits += 1;
+	} else {
+		profile->counts[slot].misses += 1;
+	}
+}
+
+#endif
@@ -1,10 +1,361 @@
-#include "spim.h"
-#include "pipeline.h"
-
-
-void print_result(int n_cycle, int n_dstall, int n_bstall)
-{
-	printf("Number of Cycle : %d\n", n_cycle);	
-	printf("Number of Stall by Data Hazard : %d\n", n_dstall);
-	printf("Number of Stall by Branch (Jump) : %d\n", n_bstall);
-}
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "spim.h"
+#include "string-stream.h"
+#include "inst.h"
+#include "parser_yacc.h"
+#include "pipeline.h"
+
+#define NOT_FORWARDED (LLONG_MAX / 4)
+#define NO_PRODUCER (LLONG_MIN / 4)
+
+Pipeline* pipelineModel = NULL;
+
+void print_result(int n_cycle, int n_dstall, int n_bstall)
+{
+	printf("Number of Cycle : %d\n", n_cycle);
+	printf("Number of Stall by Data Hazard : %d\n", n_dstall);
+	printf("Number of Stall by Branch (Jump) : %d\n", n_bstall);
+}
+
+static int stageIndex(Pipeline* pipeline, const char* name, const char* keyword, const char* path) {
+	int i;
+
+	for (i = 0; name != NULL && i < pipeline->numberOfStages; i++) {
+		if (strcmp(pipeline->names[i], name) == 0) {
+			return i;
+		}
+	}
+	printf("%s in %s needs one of the stages of the first line\n", keyword, path);
+	exit(1);
+}
+
+static int positiveNumber(const char* text, const char* keyword, const char* path) {
+	int number = text != NULL ? atoi(text) : 0;
+
+	if (number < 1) {
+		printf("%s in %s needs a number of at least 1\n", keyword, path);
+		exit(1);
+	}
+	return number;
+}
+
+static int firstForward(Pipeline* pipeline, int stage) {
+	for (; stage < pipeline->numberOfStages; stage++) {
+		if (pipeline->forward[stage]) {
+			return stage;
+		}
+	}
+	return -1;
+}
+
+static void checkPipeline(Pipeline* pipeline, const char* path) {
+	const char* keywords[7] = { "DECODE", "READ", "EXECUTE", "BRANCH", "RESULT", "LOAD", "WRITEBACK" };
+	int stages[7] = { pipeline->decodeStage, pipeline->readStage, pipeline->executeStage, pipeline->branchStage,
+		pipeline->resultStage, pipeline->loadStage, pipeline->writebackStage };
+	int i;
+
+	for (i = 0; i < 7; i++) {
+		if (stages[i] < 0) {
+			printf("%s is missing in %s\n", keywords[i], path);
+			exit(1);
+		}
+	}
+	if (pipeline->readStage > pipeline->executeStage || pipeline->readStage > pipeline->branchStage
+		|| pipeline->decodeStage > pipeline->branchStage) {
+		printf("The stages of %s must decode and read registers before they execute or resolve branches\n", path);
+		exit(1);
+	}
+	if (pipeline->resultStage < pipeline->executeStage || pipeline->loadStage < pipeline->executeStage
+		|| pipeline->writebackStage < pipeline->resultStage || pipeline->writebackStage < pipeline->loadStage) {
+		printf("The stages of %s must produce results after they execute and write them back last\n", path);
+		exit(1);
+	}
+}
+
+void load_pipeline_config(char* path) {
+	Pipeline* pipeline = (Pipeline *) calloc(1, sizeof(Pipeline));
+	char buffer[200];
+	char* save;
+	char* temp;
+	int i;
+	FILE* file = fopen(path, "r");
+
+	if (file == NULL) {
+		printf("Cannot open the pipeline file %s\n", path);
+		exit(1);
+	}
+
+	do {
+		if (fgets(buffer, sizeof(buffer), file) == NULL) {
+			printf("%s does not name the stages of the pipeline\n", path);
+			exit(1);
+		}
+		temp = strtok_r(buffer, " \t\r\n", &save);
+	} while (temp == NULL);
+	while (temp != NULL) {
+		if (pipeline->numberOfStages == MAX_PIPELINE_STAGES || strlen(temp) >= sizeof(pipeline->names[0])) {
+			printf("%s can have up to %d stages with names of up to %d characters\n",
+				path, MAX_PIPELINE_STAGES, (int) sizeof(pipeline->names[0]) - 1);
+			exit(1);
+		}
+		strcpy(pipeline->names[pipeline->numberOfStages++], temp);
+		temp = strtok_r(NULL, " \t\r\n", &save);
+	}
+	if (pipeline->numberOfStages < 2) {
+		printf("%s needs at least two stages\n", path);
+		exit(1);
+	}
+
+	pipeline->decodeStage = -1;
+	pipeline->readStage = -1;
+	pipeline->executeStage = -1;
+	pipeline->branchStage = -1;
+	pipeline->resultStage = -1;
+	pipeline->loadStage = -1;
+	pipeline->writebackStage = -1;
+	pipeline->issueWidth = 1;
+	pipeline->memoryPorts = 1;
+	pipeline->branchUnits = 1;
+	while (fgets(buffer, sizeof(buffer), file) != NULL) {
+		temp = strtok_r(buffer, " \t\r\n", &save);
+		if (temp == NULL) {
+			continue;
+		}
+		char* next = strtok_r(NULL, " \t\r\n", &save);
+		if (strcmp(temp, "DECODE") == 0) {
+			pipeline->decodeStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "READ") == 0) {
+			pipeline->readStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "EXECUTE") == 0) {
+			pipeline->executeStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "BRANCH") == 0) {
+			pipeline->branchStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "RESULT") == 0) {
+			pipeline->resultStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "LOAD") == 0) {
+			pipeline->loadStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "WRITEBACK") == 0) {
+			pipeline->writebackStage = stageIndex(pipeline, next, temp, path);
+		} else if (strcmp(temp, "FORWARD") == 0) {
+			while (next != NULL) {
+				pipeline->forward[stageIndex(pipeline, next, temp, path)] = true;
+				next = strtok_r(NULL, " \t\r\n", &save);
+			}
+		} else if (strcmp(temp, "PREDICT") == 0 && next != NULL && strcmp(next, "BIMODAL") == 0) {
+			next = strtok_r(NULL, " \t\r\n", &save);
+			pipeline->predictorSize = next != NULL ? atoi(next) : 0;
+			if (pipeline->predictorSize < 1 || (pipeline->predictorSize & (pipeline->predictorSize - 1)) != 0) {
+				printf("PREDICT BIMODAL in %s needs a power of two of counters\n", path);
+				exit(1);
+			}
+		} else if (strcmp(temp, "ISSUE") == 0) {
+			pipeline->issueWidth = positiveNumber(next, temp, path);
+		} else if (strcmp(temp, "MEMORY_PORTS") == 0) {
+			pipeline->memoryPorts = positiveNumber(next, temp, path);
+		} else if (strcmp(temp, "BRANCH_UNITS") == 0) {
+			pipeline->branchUnits = positiveNumber(next, temp, path);
+		} else {
+			printf("Unknown line %s in %s\n", temp, path);
+			exit(1);
+		}
+	}
+	fclose(file);
+	checkPipeline(pipeline, path);
+
+	pipeline->resultForward = firstForward(pipeline, pipeline->resultStage);
+	pipeline->loadForward = firstForward(pipeline, pipeline->loadStage);
+	if (pipeline->predictorSize > 0) {
+		pipeline->predictor = (unsigned char *) malloc(pipeline->predictorSize);
+		memset(pipeline->predictor, 1, pipeline->predictorSize);	// weakly not taken
+	}
+	for (i = 0; i < PIPELINE_REGISTERS; i++) {
+		pipeline->forwardReady[i] = NO_PRODUCER;
+		pipeline->written[i] = NO_PRODUCER;
+	}
+	pipeline->cycle = -1;
+	pipeline->groupSize = pipeline->issueWidth;	// the first instruction starts a group
+
+	pipelineModel = pipeline;
+}
+
+/* The cycle from which a consumer that needs register r in stage need
+   has it, from a bypass or from the register file. */
+static long long readyCycle(Pipeline* pipeline, int r, int need) {
+	long long ready = pipeline->written[r] - pipeline->readStage;
+
+	if (pipeline->forwardReady[r] - need < ready) {
+		ready = pipeline->forwardReady[r] - need;
+	}
+	return ready;
+}
+
+static void writeRegister(Pipeline* pipeline, int r, long long issue, int forward) {
+	pipeline->forwardReady[r] = forward >= 0 ? issue + forward + 1 : NOT_FORWARDED;
+	pipeline->written[r] = issue + pipeline->writebackStage;
+}
+
+static bool isControl(int opcode) {
+	return opcode_is_branch(opcode) || opcode_is_jump(opcode) || opcode == Y_JR_OP || opcode == Y_JALR_OP;
+}
+
+/* The rule that keeps inst out of the issue group of the last cycle,
+   which has room, or -1 when it may join once its operands are ready. */
+static int pairFailure(Pipeline* pipeline, struct inst_s* inst) {
+	if (pipeline->groupRedirected) {
+		return PAIR_TAKEN;
+	}
+	if (((REG_USES(inst) | REG_DEFS(inst)) & pipeline->groupDefs) || ((FPR_USES(inst) | FPR_DEFS(inst)) & pipeline->groupFprDefs)) {
+		return PAIR_DEPENDENCE;
+	}
+	if ((HAZARD(inst) & HAZARD_MEMORY) && pipeline->groupMemory == pipeline->memoryPorts) {
+		return PAIR_MEMORY;
+	}
+	if (isControl(OPCODE(inst)) && pipeline->groupBranches == pipeline->branchUnits) {
+		return PAIR_BRANCH;
+	}
+	return -1;
+}
+
+/* inst enters the first stage with the issue group of the previous
+   instruction when it can pair with it, otherwise the cycle after, or
+   later when one of the registers it reads is not ready by the time it
+   needs it. */
+int issue_instruction(Pipeline* pipeline, struct inst_s* inst) {
+	unsigned long long uses = REG_USES(inst);
+	unsigned long long defs = REG_DEFS(inst);
+	unsigned int fprUses = FPR_USES(inst);
+	unsigned int fprDefs = FPR_DEFS(inst);
+	int need = HAZARD(inst) & HAZARD_BRANCH ? pipeline->branchStage : pipeline->executeStage;
+	int forward = HAZARD(inst) & HAZARD_LOAD ? pipeline->loadForward : pipeline->resultForward;
+	bool room = pipeline->groupSize < pipeline->issueWidth;
+	int failure = room ? pairFailure(pipeline, inst) : -1;
+	long long next = pipeline->cycle + 1;
+	long long cycle = room && failure < 0 ? pipeline->cycle : next;
+	long long issue = cycle;
+	int stalls = 0;
+
+	for (; uses != 0; uses &= uses - 1) {
+		long long ready = readyCycle(pipeline, __builtin_ctzll(uses), need);
+		if (ready > issue) {
+			issue = ready;
+		}
+	}
+	for (; fprUses != 0; fprUses &= fprUses - 1) {
+		long long ready = readyCycle(pipeline, PIPELINE_FPR + __builtin_ctz(fprUses), need);
+		if (ready > issue) {
+			issue = ready;
+		}
+	}
+	if (issue > next) {
+		stalls = (int) (issue - next);
+		pipeline->held[need > pipeline->readStage ? need - 1 : pipeline->readStage] += stalls;
+		pipeline->dataStalls += stalls;
+	}
+	pipeline->paired = issue == pipeline->cycle;
+	if (pipeline->paired) {
+		pipeline->groupSize += 1;
+		pipeline->pairedInstructions += 1;
+	} else {
+		if (room) {
+			pipeline->pairFailures[failure < 0 ? PAIR_OPERANDS : failure] += 1;
+		}
+		pipeline->groupSize = 1;
+		pipeline->groupMemory = 0;
+		pipeline->groupBranches = 0;
+		pipeline->groupDefs = 0;
+		pipeline->groupFprDefs = 0;
+		pipeline->groupRedirected = false;
+		pipeline->issueCycles += 1;
+	}
+	pipeline->groupMemory += HAZARD(inst) & HAZARD_MEMORY ? 1 : 0;
+	pipeline->groupBranches += isControl(OPCODE(inst)) ? 1 : 0;
+	pipeline->groupDefs |= defs;
+	pipeline->groupFprDefs |= fprDefs;
+	pipeline->cycle = issue;
+	pipeline->instructions += 1;
+
+	for (; defs != 0; defs &= defs - 1) {
+		writeRegister(pipeline, __builtin_ctzll(defs), issue, forward);
+	}
+	for (; fprDefs != 0; fprDefs &= fprDefs - 1) {
+		writeRegister(pipeline, PIPELINE_FPR + __builtin_ctz(fprDefs), issue, forward);
+	}
+	return stalls;
+}
+
+/* Jumps flush what was fetched before their target is known, at the end
+   of the decode stage, or of the branch stage for jr. A branch costs the
+   branch stage when it is mispredicted and the decode stage when it is
+   correctly predicted taken. Nothing after a jump, a taken branch or a
+   flush issues in its group. */
+int resolve_branch(Pipeline* pipeline, struct inst_s* inst, unsigned int pc, bool taken) {
+	int opcode = OPCODE(inst);
+	int bubbles = 0;
+
+	if (opcode_is_jump(opcode)) {
+		bubbles = pipeline->decodeStage;
+	} else if (opcode == Y_JR_OP || opcode == Y_JALR_OP) {
+		bubbles = pipeline->branchStage;
+	} else if (opcode_is_branch(opcode)) {
+		bool predicted = false;
+		if (pipeline->predictorSize > 0) {
+			unsigned char* counter = &pipeline->predictor[(pc >> 2) & (pipeline->predictorSize - 1)];
+			predicted = *counter >= 2;
+			if (taken && *counter < 3) {
+				*counter += 1;
+			} else if (!taken && *counter > 0) {
+				*counter -= 1;
+			}
+		}
+		if (predicted != taken) {
+			bubbles = pipeline->branchStage;
+			pipeline->mispredictions += 1;
+		} else if (taken) {
+			bubbles = pipeline->decodeStage;
+		}
+	}
+	if (bubbles > 0 || taken) {
+		pipeline->groupRedirected = true;
+	}
+	pipeline->cycle += bubbles;
+	pipeline->branchStalls += bubbles;
+	return bubbles;
+}
+
+/* Every issue group is busy in every stage for one cycle. A stage is
+   stalled while an instruction waits for an operand in it or in a later
+   stage, and while a cache miss freezes the pipeline; it is empty
+   otherwise, which includes filling, draining and flushed fetches. */
+void print_pipeline_result(Pipeline* pipeline, int n_cycle) {
+	long long pipelineCycles = pipeline->numberOfStages - 1 + pipeline->issueCycles + pipeline->dataStalls + pipeline->branchStalls;
+	long long stalled = n_cycle > pipelineCycles ? n_cycle - pipelineCycles : 0;
+	long long stalledCycles[MAX_PIPELINE_STAGES];
+	int i;
+
+	for (i = pipeline->numberOfStages - 1; i >= 0; i--) {
+		stalled += pipeline->held[i];
+		stalledCycles[i] = stalled;
+	}
+
+	printf("Pipeline Occupancy (%d stages)\n", pipeline->numberOfStages);
+	if (pipeline->predictorSize > 0) {
+		printf("Mispredicted Branches : %lld\n", pipeline->mispredictions);
+	}
+	printf("Instructions Per Cycle : %0.3f\n", (float) pipeline->instructions / n_cycle);
+	if (pipeline->issueWidth > 1) {
+		long long* failures = pipeline->pairFailures;
+		printf("Issue Width : %d\n", pipeline->issueWidth);
+		printf("Paired Instructions : %lld (%0.3f)\n", pipeline->pairedInstructions,
+			pipeline->instructions ? (float) pipeline->pairedInstructions / pipeline->instructions : 0.0);
+		printf("Unpaired by Taken Branch: %lld, Dependence: %lld, Memory Port: %lld, Branch Unit: %lld, Operands: %lld\n",
+			failures[PAIR_TAKEN], failures[PAIR_DEPENDENCE], failures[PAIR_MEMORY], failures[PAIR_BRANCH], failures[PAIR_OPERANDS]);
+	}
+	for (i = 0; i < pipeline->numberOfStages; i++) {
+		long long empty = n_cycle - pipeline->issueCycles - stalledCycles[i];
+		printf("%s: busy %0.3f, stalled %0.3f, empty %0.3f\n", pipeline->names[i], (float) pipeline->issueCycles / n_cycle,
+			(float) stalledCycles[i] / n_cycle, (float) (empty > 0 ? empty : 0) / n_cycle);
+	}
+}
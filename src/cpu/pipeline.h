@@ -1 +1,101 @@
-void print_result(int, int, int);
+
+#ifndef __pipeline__
+#define __pipeline__
+
+/* Timing of an in-order pipeline described by a config
+   file (spim -pipeline). The first line names the stages in order; every
+   other line is a keyword with the stage it refers to:
+
+	IF ID EX MEM WB
+	DECODE ID		jump targets are known at the end of this stage
+	READ ID			registers are read from the register file
+	EXECUTE EX		ALU operands are needed at the start of this stage
+	BRANCH ID		branches and jr read their registers and resolve
+	RESULT EX		ALU results are ready at the end of this stage
+	LOAD MEM		load results are ready at the end of this stage
+	WRITEBACK WB		registers are written (read in the same cycle)
+	FORWARD EX MEM		bypasses from the end of these stages (optional)
+	PREDICT BIMODAL 256	two-bit counters per branch (optional, default: not taken)
+	ISSUE 2			instructions that enter the first stage in one cycle (optional, default 1)
+	MEMORY_PORTS 1		loads and stores among them (optional, default 1)
+	BRANCH_UNITS 1		jumps and branches among them (optional, default 1)
+
+   A scoreboard keeps, for every register, the first cycle at which a
+   consumer can take its value from a bypass or from the register file.
+   An instruction waits in its read stage until all of its operands are
+   ready, which gives the data hazard stalls; taken jumps and mispredicted
+   branches flush the stages before the one that resolves them. Cache
+   misses freeze the whole pipeline, so the model counts pipeline cycles
+   only and the run loop adds the memory stalls.
+
+   Wider than one, an instruction enters the first stage together with
+   the group of the instruction before it when the group has room, no
+   taken jump or branch ended it, the instruction neither reads nor
+   writes a register that the group writes, a memory port or branch unit
+   is free for it, and its operands are ready. The report gives the
+   instructions per cycle, the share of instructions that joined a group
+   and, for those that found room but could not join, the first of these
+   rules that failed. */
+
+#define MAX_PIPELINE_STAGES 16
+#define PIPELINE_FPR 42	// the FP registers follow the register mask bits (see set_hazard_masks)
+#define PIPELINE_REGISTERS (PIPELINE_FPR + 32)
+
+/* Why an instruction did not join the issue group before it */
+typedef enum PairFailure {
+	PAIR_TAKEN, PAIR_DEPENDENCE, PAIR_MEMORY, PAIR_BRANCH, PAIR_OPERANDS, PAIR_FAILURES,
+} PairFailure;
+
+typedef struct Pipeline {
+	int numberOfStages;
+	char names[MAX_PIPELINE_STAGES][16];
+	int decodeStage;
+	int readStage;
+	int executeStage;
+	int branchStage;
+	int resultStage;
+	int loadStage;
+	int writebackStage;
+	bool forward[MAX_PIPELINE_STAGES];
+	int resultForward;	// first bypass at or after resultStage, -1 without
+	int loadForward;	// first bypass at or after loadStage, -1 without
+	int predictorSize;	// 0: predict not taken
+	unsigned char* predictor;
+	int issueWidth;
+	int memoryPorts;
+	int branchUnits;
+	// scoreboard, in pipeline cycles
+	long long cycle;	// when the last instruction entered the first stage
+	long long forwardReady[PIPELINE_REGISTERS];	// first cycle a consumer's need stage can take the register from a bypass
+	long long written[PIPELINE_REGISTERS];	// first cycle a consumer's read stage sees the register
+	// issue group of cycle
+	int groupSize;
+	int groupMemory;
+	int groupBranches;
+	unsigned long long groupDefs;
+	unsigned int groupFprDefs;
+	bool groupRedirected;	// a jump or branch of the group changed the fetch
+	bool paired;	// the last instruction joined the group of the one before it
+	long long instructions;
+	long long dataStalls;
+	long long branchStalls;
+	long long mispredictions;
+	long long issueCycles;	// cycles in which instructions entered the first stage
+	long long pairedInstructions;
+	long long pairFailures[PAIR_FAILURES];
+	long long held[MAX_PIPELINE_STAGES];	// data stall cycles of instructions waiting in each stage
+} Pipeline;
+
+struct inst_s;
+
+/* Exported functions for the pipeline model */
+void load_pipeline_config(char* path);	// use the pipeline of path instead of the built-in five stages
+int issue_instruction(Pipeline* pipeline, struct inst_s* inst);	// data stall cycles of inst, sets paired
+int resolve_branch(Pipeline* pipeline, struct inst_s* inst, unsigned int pc, bool taken);	// bubbles after inst
+void print_pipeline_result(Pipeline* pipeline, int n_cycle);
+
+extern Pipeline* pipelineModel;
+
+void print_result(int, int, int);
+
+#endif
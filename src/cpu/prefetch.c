@@ -0,0 +1,212 @@
+/* Hardware prefetchers of the cache model:
+
+     NEXTLINE  on a trigger at line L, prefetch L + 1 .. L + degree
+     STRIDE    PC-indexed reference prediction table; a load in the steady
+               state prefetches addr + stride .. addr + degree * stride
+     STREAM    up to NUMBER_OF_STREAMS ascending or descending streams of
+               trigger lines; a confirmed stream prefetches the degree
+               lines after its last trigger
+
+   The prefetcher only proposes lines; cache.c drops the ones already in
+   the cache and fills the rest (see issuePrefetch). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+bool parsePrefetcherKind(char* name, PrefetcherKind* kind) {
+	if (strcmp(name, "NEXTLINE") == 0) {
+		*kind = NEXT_LINE_PREFETCH;
+	} else if (strcmp(name, "STRIDE") == 0) {
+		*kind = STRIDE_PREFETCH;
+	} else if (strcmp(name, "STREAM") == 0) {
+		*kind = STREAM_PREFETCH;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+const char* prefetcherName(PrefetcherKind kind) {
+	switch (kind) {
+	case NO_PREFETCH: return "NONE";
+	case NEXT_LINE_PREFETCH: return "NEXTLINE";
+	case STRIDE_PREFETCH: return "STRIDE";
+	case STREAM_PREFETCH: return "STREAM";
+	}
+	return "?";
+}
+
+Prefetcher* createPrefetcher(PrefetcherKind kind, int degree) {
+	Prefetcher* prefetcher = (Prefetcher *) calloc(1, sizeof(Prefetcher));
+
+	prefetcher->kind = kind;
+	prefetcher->degree = degree;
+	if (kind == STRIDE_PREFETCH) {
+		prefetcher->strideTable = (StrideEntry *) calloc(RPT_SIZE, sizeof(StrideEntry));
+	} else if (kind == STREAM_PREFETCH) {
+		prefetcher->streams = (StreamEntry *) calloc(NUMBER_OF_STREAMS, sizeof(StreamEntry));
+	}
+	prefetcher->pending = (PendingPrefetch *) calloc(PREFETCH_QUEUE_SIZE, sizeof(PendingPrefetch));
+	prefetcher->pollutionFilter = (unsigned int *) calloc(POLLUTION_FILTER_SIZE, sizeof(unsigned int));
+
+	return prefetcher;
+}
+
+void freePrefetcher(Prefetcher* prefetcher) {
+	free(prefetcher->strideTable);
+	free(prefetcher->streams);
+	free(prefetcher->pending);
+	free(prefetcher->pollutionFilter);
+	free(prefetcher);
+}
+
+static int trainStride(Prefetcher* prefetcher, unsigned int addr, unsigned int pc, int lineShift, unsigned int* lines) {
+	StrideEntry* entry = &prefetcher->strideTable[(pc >> 2) & (RPT_SIZE - 1)];
+	int stride = (int) (addr - entry->lastAddr);
+	bool correct = stride == entry->stride;
+	unsigned int line = addr >> lineShift;
+	int count = 0;
+	int i;
+
+	if (entry->pc != pc) {
+		entry->pc = pc;
+		entry->lastAddr = addr;
+		entry->stride = 0;
+		entry->state = STRIDE_INITIAL;
+		return 0;
+	}
+
+	switch (entry->state) {
+	case STRIDE_INITIAL:
+		entry->state = correct ? STRIDE_STEADY : STRIDE_TRANSIENT;
+		break;
+	case STRIDE_TRANSIENT:
+		entry->state = correct ? STRIDE_STEADY : STRIDE_NO_PREDICTION;
+		break;
+	case STRIDE_STEADY:
+		if (!correct) {
+			entry->state = STRIDE_INITIAL;
+		}
+		break;
+	case STRIDE_NO_PREDICTION:
+		if (correct) {
+			entry->state = STRIDE_TRANSIENT;
+		}
+		break;
+	}
+	// the stride is kept when a steady load misses its prediction once
+	if (!correct && entry->state != STRIDE_INITIAL) {
+		entry->stride = stride;
+	}
+	entry->lastAddr = addr;
+
+	if (entry->state != STRIDE_STEADY || entry->stride == 0) {
+		return 0;
+	}
+	for (i = 1; i <= prefetcher->degree; i++) {
+		unsigned int target = (addr + entry->stride * i) >> lineShift;
+		if (target != line && (count == 0 || target != lines[count - 1])) {
+			lines[count++] = target;
+		}
+	}
+	return count;
+}
+
+static int trainStream(Prefetcher* prefetcher, unsigned int line, unsigned int* lines) {
+	StreamEntry* streams = prefetcher->streams;
+	StreamEntry* stream = NULL;
+	int i;
+
+	prefetcher->streamClock += 1;
+	for (i = 0; i < NUMBER_OF_STREAMS; i++) {
+		int distance = (int) (line - streams[i].lastLine);
+		if (streams[i].lastUse != 0 && distance >= -STREAM_WINDOW && distance <= STREAM_WINDOW) {
+			stream = &streams[i];
+			break;
+		}
+	}
+
+	if (stream == NULL) {
+		stream = &streams[0];
+		for (i = 1; i < NUMBER_OF_STREAMS; i++) {
+			if (streams[i].lastUse < stream->lastUse) {
+				stream = &streams[i];
+			}
+		}
+		stream->lastLine = line;
+		stream->direction = 0;
+		stream->confidence = 0;
+		stream->lastUse = prefetcher->streamClock;
+		return 0;
+	}
+
+	int distance = (int) (line - stream->lastLine);
+	int direction = distance > 0 ? 1 : -1;
+	stream->lastUse = prefetcher->streamClock;
+	if (distance == 0) {
+		return 0;
+	}
+	if (direction == stream->direction) {
+		stream->confidence += 1;
+	} else {
+		stream->direction = direction;
+		stream->confidence = 1;
+	}
+	stream->lastLine = line;
+
+	if (stream->confidence < 2) {
+		return 0;
+	}
+	for (i = 1; i <= prefetcher->degree; i++) {
+		lines[i - 1] = line + direction * i;
+	}
+	return prefetcher->degree;
+}
+
+/* Trains the prefetcher with an access to addr by the instruction at pc
+   and stores the lines it wants prefetched in lines (at most
+   MAX_PREFETCH_DEGREE). trigger is true for a demand miss or the first
+   hit on a prefetched line. */
+int trainPrefetcher(Prefetcher* prefetcher, unsigned int addr, unsigned int pc, bool trigger, int lineShift, unsigned int* lines) {
+	unsigned int line = addr >> lineShift;
+	int i;
+
+	switch (prefetcher->kind) {
+	case NEXT_LINE_PREFETCH:
+		if (!trigger) {
+			return 0;
+		}
+		for (i = 1; i <= prefetcher->degree; i++) {
+			lines[i - 1] = line + i;
+		}
+		return prefetcher->degree;
+	case STRIDE_PREFETCH:
+		return trainStride(prefetcher, addr, pc, lineShift, lines);
+	case STREAM_PREFETCH:
+		return trigger ? trainStream(prefetcher, line, lines) : 0;
+	case NO_PREFETCH:
+		break;
+	}
+	return 0;
+}
+
+/* coverage:    fraction of the misses without prefetching that were removed
+   accuracy:    fraction of the prefetched lines that were used
+   timeliness:  fraction of the used prefetches that had arrived in time
+   pollution:   demand misses on lines a prefetch had evicted */
+void printPrefetchStats(const char* name, Prefetcher* prefetcher) {
+	PrefetchStats* stats = &prefetcher->stats;
+	long long misses = stats->useful + stats->demandMisses;
+
+	printf("%s prefetcher of %s (degree %d)\n", prefetcherName(prefetcher->kind), name, prefetcher->degree);
+	printf("Issued: %lld, Useful: %lld, Late: %lld (%lld cycles)\n", stats->issued, stats->useful, stats->late, stats->lateCycles);
+	printf("Coverage: %0.3f, Accuracy: %0.3f, Timeliness: %0.3f\n",
+		misses ? (float) stats->useful / misses : 0.0,
+		stats->issued ? (float) stats->useful / stats->issued : 0.0,
+		stats->useful ? (float) (stats->useful - stats->late) / stats->useful : 0.0);
+	printf("Pollution Misses: %lld (%0.3f of demand misses)\n", stats->pollutionMisses,
+		stats->demandMisses ? (float) stats->pollutionMisses / stats->demandMisses : 0.0);
+}
@@ -0,0 +1,119 @@
+
+#ifndef __prefetch__
+#define __prefetch__
+
+typedef enum PrefetcherKind {
+	NO_PREFETCH, NEXT_LINE_PREFETCH, STRIDE_PREFETCH, STREAM_PREFETCH,
+} PrefetcherKind;
+
+#define MAX_PREFETCH_DEGREE 8
+#define RPT_SIZE 64	// entries of the stride reference prediction table
+#define NUMBER_OF_STREAMS 16
+#define STREAM_WINDOW 16	// lines around the last miss of a stream that still belong to it
+#define PREFETCH_QUEUE_SIZE 256
+#define POLLUTION_FILTER_SIZE 1024
+
+typedef enum StrideState {
+	STRIDE_INITIAL, STRIDE_TRANSIENT, STRIDE_STEADY, STRIDE_NO_PREDICTION,
+} StrideState;
+
+/* Reference prediction table entry (Chen and Baer): the last address and
+   stride of the load at pc. Prefetches are only issued in the steady
+   state, i.e. after the same stride was seen twice in a row. */
+typedef struct StrideEntry {
+	unsigned int pc;
+	unsigned int lastAddr;
+	int stride;
+	StrideState state;
+} StrideEntry;
+
+/* A stream is confirmed once two triggers within STREAM_WINDOW lines move
+   in the same direction; it then runs degree lines ahead of the last one. */
+typedef struct StreamEntry {
+	unsigned int lastLine;
+	int direction;
+	int confidence;
+	unsigned int lastUse;
+} StreamEntry;
+
+/* Lines that are on their way to the cache, so that a demand access can
+   tell whether its prefetch arrived in time. */
+typedef struct PendingPrefetch {
+	unsigned int line;
+	long long readyCycle;
+} PendingPrefetch;
+
+typedef struct PrefetchStats {
+	long long issued;
+	long long useful;
+	long long late;
+	long long lateCycles;
+	long long demandMisses;
+	long long pollutionMisses;
+} PrefetchStats;
+
+/* Prefetcher of one cache. Triggers are demand misses and the first hit
+   on a prefetched line (which would have been a miss without it); the
+   stride table is trained by every access. pollutionFilter remembers
+   lines a prefetch evicted until they are filled again; a demand miss on
+   one of them is counted as pollution. */
+typedef struct Prefetcher {
+	PrefetcherKind kind;
+	int degree;
+	StrideEntry* strideTable;
+	StreamEntry* streams;
+	unsigned int streamClock;
+	PendingPrefetch* pending;
+	unsigned int* pollutionFilter;
+	PrefetchStats stats;
+} Prefetcher;
+
+bool parsePrefetcherKind(char* name, PrefetcherKind* kind);
+const char* prefetcherName(PrefetcherKind kind);
+
+Prefetcher* createPrefetcher(PrefetcherKind kind, int degree);
+void freePrefetcher(Prefetcher* prefetcher);
+int trainPrefetcher(Prefetcher* prefetcher, unsigned int addr, unsigned int pc, bool trigger, int lineShift, unsigned int* lines);	// number of lines to prefetch
+void printPrefetchStats(const char* name, Prefetcher* prefetcher);
+
+static inline void recordPrefetch(Prefetcher* prefetcher, unsigned int line, long long readyCycle) {
+	PendingPrefetch* pending = &prefetcher->pending[line & (PREFETCH_QUEUE_SIZE - 1)];
+
+	pending->line = line;
+	pending->readyCycle = readyCycle;
+	prefetcher->stats.issued += 1;
+}
+
+/* Arrival cycle of a prefetched line, or 0 if it is no longer tracked. */
+static inline long long prefetchReadyCycle(Prefetcher* prefetcher, unsigned int line) {
+	PendingPrefetch* pending = &prefetcher->pending[line & (PREFETCH_QUEUE_SIZE - 1)];
+
+	return pending->line == line ? pending->readyCycle : 0;
+}
+
+static inline void recordPrefetchVictim(Prefetcher* prefetcher, unsigned int line) {
+	prefetcher->pollutionFilter[line & (POLLUTION_FILTER_SIZE - 1)] = line + 1;
+}
+
+/* line is in the cache again, so a later miss on it is not caused by the
+   prefetch that evicted it. */
+static inline void forgetPrefetchVictim(Prefetcher* prefetcher, unsigned int line) {
+	unsigned int* slot = &prefetcher->pollutionFilter[line & (POLLUTION_FILTER_SIZE - 1)];
+
+	if (*slot == line + 1) {
+		*slot = 0;
+	}
+}
+
+/* True when line was evicted by a prefetch; forgets it either way. */
+static inline bool checkPollution(Prefetcher* prefetcher, unsigned int line) {
+	unsigned int* slot = &prefetcher->pollutionFilter[line & (POLLUTION_FILTER_SIZE - 1)];
+
+	if (*slot != line + 1) {
+		return false;
+	}
+	*slot = 0;
+	return true;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/* Replacement policies of the cache model.
+   Every policy updates its state and picks a victim without scanning
+   timestamps:
+
+     LRU        exact LRU with an age matrix; an update is one row store
+                and numberOfWay column clears, the victim is the row that
+                is all zeros (found with the tag matcher)
+     FIFO       round-robin pointer per set
+     TREE_PLRU  binary tree of numberOfWay - 1 bits; an update is one
+                masked store, the victim walk is O(log ways)
+     BIT_PLRU   one MRU bit per way, O(1)
+     SRRIP      2-bit re-reference prediction, lines inserted with a long
+                re-reference interval, hits predicted near-immediate
+     BRRIP      like SRRIP, but most lines are inserted with a distant
+                interval so a streaming scan cannot flush the set
+     DRRIP      set dueling between SRRIP and BRRIP leader sets; a 10-bit
+                PSEL counter picks the insertion of the follower sets
+
+   The RRIP victim search ages at most three times, each a pair of bit
+   operations over the whole set.
+
+   OPT (Belady) cannot be configured for a level; it is used to replay the
+   recorded reference stream of a level at exit (see opt.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replacement.h"
+
+bool parseReplacementPolicy(char* name, ReplacementPolicy* policy) {
+	if (strcmp(name, "LRU") == 0) {
+		*policy = LRU;
+	} else if (strcmp(name, "FIFO") == 0) {
+		*policy = FIFO;
+	} else if (strcmp(name, "PLRU") == 0) {
+		*policy = TREE_PLRU;
+	} else if (strcmp(name, "BPLRU") == 0) {
+		*policy = BIT_PLRU;
+	} else if (strcmp(name, "SRRIP") == 0) {
+		*policy = SRRIP;
+	} else if (strcmp(name, "BRRIP") == 0) {
+		*policy = BRRIP;
+	} else if (strcmp(name, "DRRIP") == 0) {
+		*policy = DRRIP;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+const char* replacementPolicyName(ReplacementPolicy policy) {
+	switch (policy) {
+	case LRU: return "LRU";
+	case FIFO: return "FIFO";
+	case TREE_PLRU: return "PLRU";
+	case BIT_PLRU: return "BPLRU";
+	case SRRIP: return "SRRIP";
+	case BRRIP: return "BRRIP";
+	case DRRIP: return "DRRIP";
+	case OPT: return "OPT";
+	}
+	return "?";
+}
+
+const char* checkReplacementPolicy(ReplacementPolicy policy, int numberOfWay) {
+	if (policy != FIFO && numberOfWay > 32) {
+		return "at most 32 ways are supported";
+	}
+	if (policy == TREE_PLRU && (numberOfWay & (numberOfWay - 1)) != 0) {
+		return "the number of ways must be a power of two";
+	}
+	return NULL;
+}
+
+static int getLevels(int numberOfWay) {
+	int levels = 0;
+
+	while ((1 << levels) < numberOfWay) {
+		levels += 1;
+	}
+	return levels;
+}
+
+/* Point every node on the path to way at the other half of the tree. */
+static void createTreePaths(ReplacementState* state) {
+	int way, level;
+
+	for (way = 0; way < state->numberOfWay; way++) {
+		int node = 1;
+		state->pathMask[way] = 0;
+		state->pathBits[way] = 0;
+		for (level = state->levels - 1; level >= 0; level--) {
+			int right = (way >> level) & 1;
+			state->pathMask[way] |= 1u << (node - 1);
+			if (!right) {
+				state->pathBits[way] |= 1u << (node - 1);
+			}
+			node = node * 2 + right;
+		}
+	}
+}
+
+/* Spread NUMBER_OF_LEADER_SETS leaders of each side evenly over the cache:
+   the first set of every constituency follows SRRIP, the last BRRIP. */
+static void createLeaderSets(ReplacementState* state, int numberOfEntries) {
+	int i;
+	int leaders = numberOfEntries / 2 < NUMBER_OF_LEADER_SETS ? numberOfEntries / 2 : NUMBER_OF_LEADER_SETS;
+
+	state->roles = (unsigned char *) calloc(numberOfEntries, sizeof(unsigned char));
+	if (leaders == 0) {
+		return;
+	}
+	int constituency = numberOfEntries / leaders;
+	for (i = 0; i < leaders; i++) {
+		state->roles[i * constituency] = SRRIP_LEADER;
+		state->roles[i * constituency + constituency - 1] = BRRIP_LEADER;
+	}
+}
+
+void createReplacementState(ReplacementState* state, ReplacementPolicy policy, int numberOfEntries, int numberOfWay) {
+	state->policy = policy;
+	state->numberOfWay = numberOfWay;
+	state->levels = getLevels(numberOfWay);
+	state->fullMask = numberOfWay >= 32 ? 0xffffffffu : (1u << numberOfWay) - 1;
+	state->bits = (unsigned int *) calloc(numberOfEntries, sizeof(unsigned int));
+	state->matrix = NULL;
+	state->findRow = selectTagMatch(numberOfWay);
+
+	if (policy == LRU) {
+		state->matrix = (unsigned int *) calloc(numberOfEntries * numberOfWay, sizeof(unsigned int));
+	} else if (policy == TREE_PLRU) {
+		createTreePaths(state);
+	}
+
+	state->planes = NULL;
+	state->roles = NULL;
+	state->psel = PSEL_MAX / 2;
+	state->brripFills = 0;
+	memset(&state->duel, 0, sizeof(DuelingStats));
+	if (policy == SRRIP || policy == BRRIP || policy == DRRIP) {
+		int i;
+		state->planes = (unsigned int *) malloc(sizeof(unsigned int) * 2 * numberOfEntries);
+		for (i = 0; i < 2 * numberOfEntries; i++) {
+			state->planes[i] = state->fullMask;
+		}
+	}
+	if (policy == DRRIP) {
+		createLeaderSets(state, numberOfEntries);
+	}
+
+	state->nextUse = NULL;
+	state->currentNextUse = 0;
+	if (policy == OPT) {
+		state->nextUse = (unsigned int *) calloc(numberOfEntries * numberOfWay, sizeof(unsigned int));
+	}
+}
+
+void freeReplacementState(ReplacementState* state) {
+	free(state->bits);
+	free(state->matrix);
+	free(state->planes);
+	free(state->roles);
+	free(state->nextUse);
+}
+
+void printReplacementStats(const char* name, ReplacementState* state) {
+	DuelingStats* duel = &state->duel;
+	long long followerFills = duel->srripFollowerFills + duel->brripFollowerFills;
+
+	if (state->policy != DRRIP) {
+		return;
+	}
+	printf("DRRIP set dueling of %s (PSEL %d)\n", name, state->psel);
+	printf("Leader Misses: SRRIP %lld, BRRIP %lld\n", duel->srripLeaderMisses, duel->brripLeaderMisses);
+	printf("Follower Fills: SRRIP %lld (%0.3f), BRRIP %lld (%0.3f)\n",
+		duel->srripFollowerFills, followerFills ? (float) duel->srripFollowerFills / followerFills : 0.0,
+		duel->brripFollowerFills, followerFills ? (float) duel->brripFollowerFills / followerFills : 0.0);
+}
@@ -0,0 +1,249 @@
+
+#ifndef __replacement__
+#define __replacement__
+
+#include "tag-match.h"
+
+typedef enum ReplacementPolicy {
+  LRU, FIFO, TREE_PLRU, BIT_PLRU, SRRIP, BRRIP, DRRIP, OPT,
+} ReplacementPolicy;
+
+#define RRPV_LONG 2
+#define RRPV_DISTANT 3
+#define BRRIP_LONG_INTERVAL 32	// BRRIP inserts every 32nd line with a long RRPV
+#define PSEL_MAX 1023
+#define NUMBER_OF_LEADER_SETS 32	// per dueling side
+
+typedef enum SetRole {
+	FOLLOWER, SRRIP_LEADER, BRRIP_LEADER,
+} SetRole;
+
+/* How the DRRIP set duel went: misses in the leader sets of each side and
+   how many follower fills each side decided. */
+typedef struct DuelingStats {
+	long long srripLeaderMisses;
+	long long brripLeaderMisses;
+	long long srripFollowerFills;
+	long long brripFollowerFills;
+} DuelingStats;
+
+/* Replacement state of every set of one cache.
+   bits holds one word per set: the FIFO pointer, the tree-PLRU node bits
+   or the bit-PLRU MRU bits. matrix holds the LRU age matrix, numberOfWay
+   rows per set; bit j of row i is set when way i was used after way j.
+   pathMask/pathBits give, for every way, the tree-PLRU nodes on its path
+   and the values that make them point away from it.
+   The 2-bit RRIP prediction values are kept as two bit planes per set,
+   planes[2 * set] (low bits) and planes[2 * set + 1] (high bits), so
+   aging a whole set is two logic operations.
+   OPT is only used to replay a recorded stream (see opt.h): the caller
+   stores the next use of the current reference in currentNextUse before
+   the access, and nextUse keeps it per line. */
+typedef struct ReplacementState {
+	ReplacementPolicy policy;
+	int numberOfWay;
+	int levels;
+	unsigned int fullMask;
+	unsigned int* bits;
+	unsigned int* matrix;
+	unsigned int pathMask[32];
+	unsigned int pathBits[32];
+	TagMatchFunction findRow;
+	unsigned int* planes;
+	unsigned char* roles;
+	int psel;
+	int brripFills;
+	DuelingStats duel;
+	unsigned int* nextUse;
+	unsigned int currentNextUse;
+} ReplacementState;
+
+bool parseReplacementPolicy(char* name, ReplacementPolicy* policy);
+const char* replacementPolicyName(ReplacementPolicy policy);
+const char* checkReplacementPolicy(ReplacementPolicy policy, int numberOfWay);	// NULL or why the geometry is unsupported
+
+void createReplacementState(ReplacementState* state, ReplacementPolicy policy, int numberOfEntries, int numberOfWay);
+void freeReplacementState(ReplacementState* state);
+void printReplacementStats(const char* name, ReplacementState* state);
+
+/* The per-access updates are inlined into the cache lookup. */
+
+static inline void touchMatrix(ReplacementState* state, int set, int way) {
+	int i;
+	int numberOfWay = state->numberOfWay;
+	unsigned int* rows = state->matrix + set * numberOfWay;
+	unsigned int column = ~(1u << way);
+
+	for (i = 0; i < numberOfWay; i++) {
+		rows[i] &= column;
+	}
+	rows[way] = state->fullMask & column;
+}
+
+static inline void touchTree(ReplacementState* state, int set, int way) {
+	state->bits[set] = (state->bits[set] & ~state->pathMask[way]) | state->pathBits[way];
+}
+
+static inline int treeVictim(ReplacementState* state, int set) {
+	int level;
+	int node = 1;
+	int way = 0;
+	unsigned int bits = state->bits[set];
+
+	for (level = 0; level < state->levels; level++) {
+		int right = (bits >> (node - 1)) & 1;
+		way = way * 2 + right;
+		node = node * 2 + right;
+	}
+	return way;
+}
+
+static inline void touchBits(ReplacementState* state, int set, int way) {
+	unsigned int bits = state->bits[set] | (1u << way);
+
+	state->bits[set] = (bits == state->fullMask) ? (1u << way) : bits;
+}
+
+static inline void setRRPV(ReplacementState* state, int set, int way, int rrpv) {
+	unsigned int* planes = state->planes + 2 * set;
+	unsigned int bit = 1u << way;
+
+	planes[0] = (planes[0] & ~bit) | ((rrpv & 1) ? bit : 0);
+	planes[1] = (planes[1] & ~bit) | ((rrpv & 2) ? bit : 0);
+}
+
+/* Age the set until some way has a distant RRPV and return the first one.
+   Adding one to every 2-bit value below 3 is lo' = ~lo, hi' = hi ^ lo. */
+static inline int rripVictim(ReplacementState* state, int set) {
+	unsigned int* planes = state->planes + 2 * set;
+	unsigned int lo = planes[0];
+	unsigned int hi = planes[1];
+
+	while ((lo & hi) == 0) {
+		unsigned int carry = lo;
+		lo = ~lo & state->fullMask;
+		hi = hi ^ carry;
+	}
+	planes[0] = lo;
+	planes[1] = hi;
+	return __builtin_ctz(lo & hi);
+}
+
+static inline int brripInsertion(ReplacementState* state) {
+	state->brripFills += 1;
+	if (state->brripFills == BRRIP_LONG_INTERVAL) {
+		state->brripFills = 0;
+		return RRPV_LONG;
+	}
+	return RRPV_DISTANT;
+}
+
+/* A fill is a miss: leader sets move PSEL towards the other side, and
+   followers insert like the side that is missing less. */
+static inline int drripInsertion(ReplacementState* state, int set) {
+	switch (state->roles[set]) {
+	case SRRIP_LEADER:
+		state->duel.srripLeaderMisses += 1;
+		if (state->psel < PSEL_MAX) state->psel += 1;
+		return RRPV_LONG;
+	case BRRIP_LEADER:
+		state->duel.brripLeaderMisses += 1;
+		if (state->psel > 0) state->psel -= 1;
+		return brripInsertion(state);
+	}
+	if (state->psel > PSEL_MAX / 2) {
+		state->duel.brripFollowerFills += 1;
+		return brripInsertion(state);
+	}
+	state->duel.srripFollowerFills += 1;
+	return RRPV_LONG;
+}
+
+static inline void updateOnHit(ReplacementState* state, int set, int way) {
+	switch (state->policy) {
+	case LRU:
+		touchMatrix(state, set, way);
+		break;
+	case TREE_PLRU:
+		touchTree(state, set, way);
+		break;
+	case BIT_PLRU:
+		touchBits(state, set, way);
+		break;
+	case SRRIP:
+	case BRRIP:
+	case DRRIP:
+		setRRPV(state, set, way, 0);
+		break;
+	case OPT:
+		state->nextUse[set * state->numberOfWay + way] = state->currentNextUse;
+		break;
+	case FIFO:
+		break;
+	}
+}
+
+static inline int optVictim(ReplacementState* state, int set) {
+	int i;
+	int victim = 0;
+	unsigned int* nextUse = state->nextUse + set * state->numberOfWay;
+
+	for (i = 1; i < state->numberOfWay; i++) {
+		if (nextUse[i] > nextUse[victim]) {
+			victim = i;
+		}
+	}
+	return victim;
+}
+
+static inline void updateOnFill(ReplacementState* state, int set, int way) {
+	switch (state->policy) {
+	case SRRIP:
+		setRRPV(state, set, way, RRPV_LONG);
+		break;
+	case BRRIP:
+		setRRPV(state, set, way, brripInsertion(state));
+		break;
+	case DRRIP:
+		setRRPV(state, set, way, drripInsertion(state, set));
+		break;
+	default:
+		updateOnHit(state, set, way);
+		break;
+	}
+}
+
+static inline int chooseVictim(ReplacementState* state, int set) {
+	int way = 0;
+
+	if (state->numberOfWay == 1) {
+		return 0;
+	}
+
+	switch (state->policy) {
+	case LRU:
+		way = state->findRow(state->matrix + set * state->numberOfWay, state->numberOfWay, 0);
+		break;
+	case FIFO:
+		way = state->bits[set];
+		state->bits[set] = (way + 1 == state->numberOfWay) ? 0 : way + 1;
+		break;
+	case TREE_PLRU:
+		way = treeVictim(state, set);
+		break;
+	case BIT_PLRU:
+		way = __builtin_ctz(~state->bits[set] & state->fullMask);
+		break;
+	case SRRIP:
+	case BRRIP:
+	case DRRIP:
+		way = rripVictim(state, set);
+		break;
+	case OPT:
+		way = optVictim(state, set);
+		break;
+	}
+	return way;
+}
+
+#endif
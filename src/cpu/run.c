@@ -61,8 +61,9 @@
 #include "parser_yacc.h"
 #include "syscall.h"
 #include "run.h"
-#include "pipeline.h"
+#include "timing.h"
 #include "cache.h"
+#include "trace.h"
 
 bool force_break = false;	/* For the execution env. to force an execution break */
 
@@ -75,6 +76,7 @@ bool force_break = false;	/* For the execution env. to force an execution break
 /* Local functions: */
 
 static void bump_CP0_timer ();
+static char *describe_pc (unsigned int pc);
 static void set_fpu_cc (int cond, int cc, int less, int equal, int unordered);
 static void signed_multiply (reg_word v1, reg_word v2);
 static void start_CP0_timer ();
@@ -83,6 +85,7 @@ void CALLBACK timer_completion_routine(LPVOID lpArgToCompletionRoutine,
 				       DWORD dwTimerLowValue, DWORD dwTimerHighValue);
 #endif
 static void unsigned_multiply (reg_word v1, reg_word v2);
+static bool branch_taken (instruction *inst);
 
 
 #define SIGN_BIT(X) ((X) & 0x80000000)
@@ -191,20 +194,14 @@ bool
 run_spim (mem_addr initial_PC, int steps_to_run, bool display)
 {
   instruction *inst;
-  instruction *inst1=NULL;
-  instruction *inst2=NULL;
   static reg_word *delayed_load_addr1 = NULL, delayed_load_value1;
   static reg_word *delayed_load_addr2 = NULL, delayed_load_value2;
   int step, step_size, next_step;
 
   bool jal = true;
-  bool bp = true;
-  int i = 0;
-  int PB[8] = {0,};
-  mem_addr BIA[8] = {0};
-  
-  int n_cycle = 4, n_datah = 0, n_dataf = 0, n_dstall = 0, n_bstall = 0, n_dh = 0;
-  int stall = 0;
+  mem_addr inst_pc = 0;
+
+  begin_timing ();
 
   PC = initial_PC;
   if (!bare_machine && mapped_io)
@@ -269,256 +266,15 @@ run_spim (mem_addr initial_PC, int steps_to_run, bool display)
 	  }
 #endif
 	  exception_occurred = 0;
-	  if(stall==3) {inst2 = read_mem_inst (PC); inst1 = inst; stall=0;}
-	  else if(stall==2) {inst2 = read_mem_inst (PC); inst1 = inst; stall=0;}
-	  else if(stall==1) {inst2 = read_mem_inst (PC); inst1 = inst; stall=0;}
-	  else {
-		  if(step > 1) inst2 = inst1;
-	  	  if(step > 0) inst1 = inst;
-	  }
-
-	  n_cycle += instruction_load(PC);
+	  if (traceWriter != NULL) writeTraceRecord (traceWriter, TRACE_INST, PC, PC, BYTES_PER_WORD);
 	  inst = read_mem_inst (PC);
+	  inst_pc = PC;
 
-	  unsigned char tempr = 0;
-
-	  if(!jal){
-
-	  if(OPCODE (inst) == Y_ADD_OP || OPCODE (inst) == Y_SUB_OP || OPCODE (inst) == Y_AND_OP || OPCODE (inst) == Y_NOR_OP || OPCODE (inst) == Y_OR_OP || OPCODE (inst) == Y_SLT_OP || OPCODE (inst) == Y_SW_OP || OPCODE (inst) == Y_MUL_OP) {
-		if(step > 0 && inst != inst1) {
-			if( OPCODE (inst1) == Y_ADD_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SUB_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_AND_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_NOR_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_OR_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLT_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SRL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_MUL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_ADDI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ANDI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LUI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ORI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_SLTI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LW_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1);}
-			if(step > 1 && inst != inst2) {
-				if( tempr != RD (inst2) && OPCODE (inst2) == Y_ADD_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SUB_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_AND_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_NOR_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_OR_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLT_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SRL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_MUL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ADDI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ANDI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LUI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ORI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_SLTI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LW_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) n_dataf++;
-			}
-		}
-	  }
-
-	  if(OPCODE (inst) == Y_SLL_OP || OPCODE (inst) == Y_SRL_OP) {
-		if(step > 0 && inst != inst1) {
-			if( OPCODE (inst1) == Y_ADD_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SUB_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_AND_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_NOR_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_OR_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLT_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLL_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SRL_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_MUL_OP && RD (inst1) == RT (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_ADDI_OP && RT (inst1) == RT (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ANDI_OP && RT (inst1) == RT (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LUI_OP && RT (inst1) == RT (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ORI_OP && RT (inst1) == RT (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_SLTI_OP && RT (inst1) == RT (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LW_OP && RT (inst1) == RT (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1);}
-			if(step > 1 && inst != inst2) {
-				if( tempr != RD (inst2) && OPCODE (inst2) == Y_ADD_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SUB_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_AND_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_NOR_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_OR_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLT_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLL_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SRL_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_MUL_OP && RD (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ADDI_OP && RT (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ANDI_OP && RT (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LUI_OP && RT (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ORI_OP && RT (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_SLTI_OP && RT (inst2) == RT (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LW_OP && RT (inst2) == RT (inst)) n_dataf++;
-			}
-		}
-	  }
-
-	  if(OPCODE (inst) == Y_ADDI_OP || OPCODE (inst) == Y_ANDI_OP || OPCODE (inst) == Y_ORI_OP || OPCODE (inst) == Y_SLTI_OP || OPCODE (inst) == Y_LW_OP) {
-		if(step > 0 && inst != inst1) {
-			if( OPCODE (inst1) == Y_ADD_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SUB_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_AND_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_NOR_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_OR_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLT_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SLL_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_SRL_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_MUL_OP && RD (inst1) == RS (inst)) {n_dataf++; tempr = RD (inst1);}
-			else if( OPCODE (inst1) == Y_ADDI_OP && RT (inst1) == RS (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ANDI_OP && RT (inst1) == RS (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LUI_OP && RT (inst1) == RS (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_ORI_OP && RT (inst1) == RS (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_SLTI_OP && RT (inst1) == RS (inst)) {n_dataf++; tempr = RT (inst1);}
-			else if( OPCODE (inst1) == Y_LW_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1);}
-			if(step > 1 && inst != inst2) {
-				if( tempr != RD (inst2) && OPCODE (inst2) == Y_ADD_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SUB_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_AND_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_NOR_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_OR_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLT_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLL_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SRL_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_MUL_OP && RD (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ADDI_OP && RT (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ANDI_OP && RT (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LUI_OP && RT (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ORI_OP && RT (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_SLTI_OP && RT (inst2) == RS (inst)) n_dataf++;
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LW_OP && RT (inst2) == RS (inst)) n_dataf++;
-			}
-		}
-	  }
-
-	  if(OPCODE (inst) == Y_BEQ_OP || OPCODE (inst) == Y_BNE_OP) {
-		  int stall_flag = 0;
-		if(step > 0 && inst != inst1) {
-			if( OPCODE (inst1) == Y_ADD_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SUB_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_AND_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_NOR_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_OR_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLT_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SRL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_MUL_OP && (RD (inst1) == RS (inst) || RD (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ADDI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ANDI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_LUI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ORI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLTI_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_LW_OP && (RT (inst1) == RS (inst) || RT (inst1) == RT (inst))) {stall+=2; n_dstall+=2; n_cycle+=2; n_dh++; tempr = RT (inst1); stall_flag = 2;}
-			if(step > 1 && inst != inst2) {
-				if( tempr != RD (inst2) && OPCODE (inst2) == Y_ADD_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SUB_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_AND_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_NOR_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_OR_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLT_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SRL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_MUL_OP && (RD (inst2) == RS (inst) || RD (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ADDI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ANDI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LUI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ORI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_SLTI_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(stall_flag<2) n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LW_OP && (RT (inst2) == RS (inst) || RT (inst2) == RT (inst))) {if(!stall_flag) {stall++; n_dstall++; n_cycle++;}}
-			}
-		}
-		if(bp) {
-		  int j;
-		  for(j = 0; j < 8; j++) {
-			  if(BIA[j] == PC) {
-				  if((OPCODE (inst) == Y_BEQ_OP && R[RS (inst)] == R[RT (inst)]) || (OPCODE (inst) == Y_BNE_OP && R[RS (inst)] != R[RT (inst)])) {
-					  if(PB[j] > 2) {
-						  if(++PB[j] > 4) PB[j] = 4;
-					  } else if(PB[j] < 3) {
-						  n_bstall++; n_cycle++;
-						  if(++PB[j] > 4) PB[j] = 4;
-					  }
-				  } else if((OPCODE (inst) == Y_BEQ_OP && R[RS (inst)] != R[RT (inst)]) || (OPCODE (inst) == Y_BNE_OP && R[RS (inst)] == R[RT (inst)])) {
-					  if(PB[j] > 2) {
-						  n_bstall++; n_cycle++;
-						  if(--PB[j] < 1) PB[j] = 1;
-					  } else if(PB[j] < 3) {
-						  if(--PB[j] < 1) PB[j] = 1;
-					  }
-				  }
-				  break;
-			  }
-		  }
-		  if(j==8) {
-			BIA[i] = PC;
-			if(i==8) i = 0;
-			if((OPCODE (inst) == Y_BEQ_OP && R[RS (inst)] == R[RT (inst)]) || (OPCODE (inst) == Y_BNE_OP && R[RS (inst)] != R[RT (inst)])){
-				PB[i++] = 3;
-				stall++;
-				n_bstall++;
-				n_cycle++;
-			} else PB[i++] = 1;
-		  }
-		} else {
-			if(OPCODE (inst) == Y_BEQ_OP && R[RS (inst)] == R[RT (inst)] && PC + IDISP (inst) != PC + 4) {stall++; n_bstall++; n_cycle++;}
-			if(OPCODE (inst) == Y_BNE_OP && R[RS (inst)] != R[RT (inst)] && PC + IDISP (inst) != PC + 4) {stall++; n_bstall++; n_cycle++;}
-		}
-	  }
-	
-	  if(OPCODE (inst) == Y_JR_OP) {
-		int stall_flag = 0;
-		stall++;  
-		n_bstall++;
-		n_cycle++;
-		if(step > 0 && inst != inst1) {
-			if( OPCODE (inst1) == Y_ADD_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SUB_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_AND_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_NOR_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_OR_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLT_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLL_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SRL_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_MUL_OP && RD (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RD (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ADDI_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ANDI_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_LUI_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_ORI_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_SLTI_OP && RT (inst1) == RS (inst)) {stall++; n_dstall++; n_cycle++; tempr = RT (inst1); stall_flag = 1;}
-			else if( OPCODE (inst1) == Y_LW_OP && RT (inst1) == RS (inst)) {stall+=2; n_dstall+=2; n_cycle+=2; n_dh++; tempr = RT (inst1); stall_flag = 2;}
-			if(step > 1 && inst != inst2) {
-				if( tempr != RD (inst2) && OPCODE (inst2) == Y_ADD_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SUB_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_AND_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_NOR_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_OR_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLT_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SLL_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_SRL_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RD (inst2) && OPCODE (inst2) == Y_MUL_OP && RD (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ADDI_OP && RT (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ANDI_OP && RT (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LUI_OP && RT (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_ORI_OP && RT (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_SLTI_OP && RT (inst2) == RS (inst)) {if(stall_flag<2)n_dataf++;}
-				else if( tempr != RT (inst2) && OPCODE (inst2) == Y_LW_OP && RT (inst2) == RS (inst)) {if(!stall_flag){stall++; n_dstall++; n_cycle++;}}
-			}
-		}
-	  }
-
-	  if(OPCODE (inst) == Y_J_OP || OPCODE (inst) == Y_JAL_OP) {
-		stall++; 
-		n_bstall++;
-		n_cycle++;
-	  }
-	  }
-
-	  if (OPCODE (inst) == Y_LW_OP) {n_cycle += data_load(R[BASE(inst)] + IOFFSET(inst));}
-	  if (OPCODE (inst) == Y_SW_OP)	{n_cycle += data_store(R[BASE(inst)] + IOFFSET(inst));}
+	  if (traceWriter != NULL && OPCODE (inst) == Y_LW_OP) writeTraceRecord (traceWriter, TRACE_LOAD, PC, R[BASE(inst)] + IOFFSET(inst), BYTES_PER_WORD);
+	  if (traceWriter != NULL && OPCODE (inst) == Y_SW_OP) writeTraceRecord (traceWriter, TRACE_STORE, PC, R[BASE(inst)] + IOFFSET(inst), BYTES_PER_WORD);
+	  time_instruction (PC, inst, R[BASE (inst)] + IOFFSET (inst),
+			    (jal ? 0 : TIMING_TIMED) | (step > 0 ? TIMING_AFTER_FIRST : 0) | (step > 1 ? TIMING_AFTER_SECOND : 0)
+			    | (opcode_is_branch (OPCODE (inst)) && branch_taken (inst) ? TIMING_TAKEN : 0));
 
 	  if (exception_occurred) /* In reading instruction */
 	    {
@@ -1364,9 +1120,8 @@ run_spim (mem_addr initial_PC, int steps_to_run, bool display)
 
 	    case Y_SYSCALL_OP:
 	      if (!do_syscall ()){
-				n_cycle++;
-  				print_result(n_cycle, n_dstall, n_bstall);
-				print_cache_result(n_cycle);
+				set_pc_describer (describe_pc);
+				end_timing ();
 				return false;
 		  }
 	      break;
@@ -1901,7 +1656,7 @@ run_spim (mem_addr initial_PC, int steps_to_run, bool display)
 
 	  /* After instruction executes: */
 	  PC += BYTES_PER_WORD;
-	  if(!jal) {n_cycle++;}
+	  retire_instruction (PC != inst_pc + BYTES_PER_WORD);
 
 	  if(OPCODE (inst) == Y_JAL_OP && jal) {
 		jal = false;
@@ -2002,6 +1757,78 @@ start_CP0_timer ()
 }
 
 
+/* Label and disassembly of the instruction at PC for the per-PC cache
+   profile, e.g. "loop+0x8  0x8d280000  lw $8, 0($9) ; 12: lw $t0, 0($t1)". */
+
+static char *
+describe_pc (unsigned int pc)
+{
+  label *l = label_at_or_before (pc);
+  char *inst = inst_to_string (pc);
+  char *text = strchr (inst, '\t');	/* skip the address */
+  str_stream ss;
+
+  ss_init (&ss);
+  if (l != NULL)
+    ss_printf (&ss, "%s+0x%x", l->name, pc - (mem_addr) l->addr);
+  if (text != NULL)
+    ss_printf (&ss, "  %.*s", (int) strcspn (text + 1, "\n"), text + 1);
+  if (*inst != '\0')
+    free (inst);
+  return ss_to_string (&ss);
+}
+
+
+/* Return true if the conditional branch INST will be taken, before it
+   executes. */
+
+static bool
+branch_taken (instruction *inst)
+{
+  reg_word value = R[RS (inst)];
+
+  switch (OPCODE (inst))
+    {
+    case Y_BEQ_OP:
+    case Y_BEQL_OP:
+      return value == R[RT (inst)];
+
+    case Y_BNE_OP:
+    case Y_BNEL_OP:
+      return value != R[RT (inst)];
+
+    case Y_BGEZ_OP:
+    case Y_BGEZL_OP:
+    case Y_BGEZAL_OP:
+    case Y_BGEZALL_OP:
+      return value >= 0;
+
+    case Y_BGTZ_OP:
+    case Y_BGTZL_OP:
+      return value > 0;
+
+    case Y_BLEZ_OP:
+    case Y_BLEZL_OP:
+      return value <= 0;
+
+    case Y_BLTZ_OP:
+    case Y_BLTZL_OP:
+    case Y_BLTZAL_OP:
+    case Y_BLTZALL_OP:
+      return value < 0;
+
+    case Y_BC1F_OP:
+    case Y_BC1FL_OP:
+    case Y_BC1T_OP:
+    case Y_BC1TL_OP:
+      return (FCCR & (1 << CC (inst))) == (TF (inst) << CC (inst));
+
+    default:
+      return false;
+    }
+}
+
+
 /* Multiply two 32-bit numbers, V1 and V2, to produce a 64 bit result in
    the HI/LO registers.	 The algorithm is high-school math:
 
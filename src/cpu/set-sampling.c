@@ -0,0 +1,119 @@
+/* Set sampling (see set-sampling.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "set-sampling.h"
+
+#define SAMPLE_SEED 0x2545f491u
+
+// two-sided 95% quantiles of Student's t for 1 .. 30 degrees of freedom
+static const double tQuantiles[30] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static double confidenceQuantile(int degreesOfFreedom) {
+	return degreesOfFreedom <= 30 ? tQuantiles[degreesOfFreedom - 1] : 1.96;
+}
+
+static unsigned int nextRandom(unsigned int* state) {
+	unsigned int x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* The groups are drawn without replacement by a partial Fisher-Yates
+   shuffle with a fixed seed, so a configuration always samples the same
+   sets and runs are repeatable. */
+SetSample* createSetSample(int shift, int bits, int ratio) {
+	SetSample* sample = (SetSample *) calloc(1, sizeof(SetSample));
+	int* order;
+	unsigned int state = SAMPLE_SEED;
+	int i;
+
+	sample->shift = shift;
+	sample->numberOfGroups = 1 << bits;
+	sample->sampledGroups = sample->numberOfGroups / ratio;
+	sample->sampled = (unsigned char *) calloc(sample->numberOfGroups, sizeof(unsigned char));
+
+	order = (int *) malloc(sizeof(int) * sample->numberOfGroups);
+	for (i = 0; i < sample->numberOfGroups; i++) {
+		order[i] = i;
+	}
+	for (i = 0; i < sample->sampledGroups; i++) {
+		int pick = i + nextRandom(&state) % (sample->numberOfGroups - i);
+		int group = order[pick];
+		order[pick] = order[i];
+		order[i] = group;
+		sample->sampled[group] = 1;
+	}
+	free(order);
+
+	return sample;
+}
+
+SampleCounts* createSampleCounts(SetSample* sample, int indexShift) {
+	SampleCounts* counts = (SampleCounts *) calloc(1, sizeof(SampleCounts));
+
+	counts->shift = sample->shift - indexShift;
+	counts->mask = sample->numberOfGroups - 1;
+	counts->accesses = (long long *) calloc(sample->numberOfGroups, sizeof(long long));
+	counts->hits = (long long *) calloc(sample->numberOfGroups, sizeof(long long));
+	return counts;
+}
+
+void freeSetSample(SetSample* sample) {
+	free(sample->sampled);
+	free(sample);
+}
+
+void freeSampleCounts(SampleCounts* counts) {
+	free(counts->accesses);
+	free(counts->hits);
+	free(counts);
+}
+
+/* Ratio estimator R = sum(hits) / sum(accesses) over the n sampled of N
+   groups, with the finite population correction:
+
+     Var(R) = (1 - n / N) / (n * mean(accesses)^2) * sum((hits - R * accesses)^2) / (n - 1)
+
+   The bound is t(n - 1) standard errors. */
+void estimateSample(SetSample* sample, SampleCounts* counts, long long* accessCount, long long* hitCount) {
+	int n = sample->sampledGroups;
+	int N = sample->numberOfGroups;
+	long long accesses = 0;
+	long long hits = 0;
+	double ratio;
+	double meanAccesses;
+	double squares = 0;
+	int i;
+
+	for (i = 0; i < N; i++) {
+		accesses += counts->accesses[i];
+		hits += counts->hits[i];
+	}
+	counts->errorBound = -1;
+	*accessCount = (long long) llround((double) accesses * N / n);
+	*hitCount = (long long) llround((double) hits * N / n);
+	if (accesses == 0) {
+		return;
+	}
+
+	ratio = (double) hits / accesses;
+	meanAccesses = (double) accesses / n;
+	for (i = 0; i < N; i++) {
+		if (sample->sampled[i]) {
+			double residual = counts->hits[i] - ratio * counts->accesses[i];
+			squares += residual * residual;
+		}
+	}
+	counts->errorBound = confidenceQuantile(n - 1) * sqrt((1.0 - (double) n / N) * squares / (n - 1) / n) / meanAccesses;
+}
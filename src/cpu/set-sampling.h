@@ -0,0 +1,54 @@
+
+#ifndef __set_sampling__
+#define __set_sampling__
+
+/* Set sampling: only the references to a random subset of the sets are
+   simulated and the counts of every cache are extrapolated from them.
+
+   The sets are sampled in groups. The group of an address is given by
+   address bits that are part of the set index of every cache, so a
+   sampled group owns whole sets at every level and each level sees all
+   the references to those sets, in order, as it would unsampled.
+
+   The hit ratio is estimated with the ratio estimator of cluster
+   sampling over the groups; its error bound is the half width of the 95%
+   confidence interval. */
+
+#define MAX_SAMPLE_BITS 16
+#define MIN_SAMPLED_GROUPS 8	// fewer give no useful variance estimate
+
+typedef struct SetSample {
+	int shift;	// lowest address bit of the group number
+	int numberOfGroups;
+	int sampledGroups;
+	unsigned char* sampled;	// per group
+} SetSample;
+
+/* Per-group counts of one cache. The group number is bits shift .. of the
+   set index. */
+typedef struct SampleCounts {
+	int shift;
+	int mask;
+	long long* accesses;
+	long long* hits;
+	double errorBound;	// negative when no sampled set was accessed
+} SampleCounts;
+
+SetSample* createSetSample(int shift, int bits, int ratio);	// samples 1 of every ratio groups
+SampleCounts* createSampleCounts(SetSample* sample, int indexShift);
+void freeSetSample(SetSample* sample);
+void freeSampleCounts(SampleCounts* counts);
+void estimateSample(SetSample* sample, SampleCounts* counts, long long* accessCount, long long* hitCount);	// also sets errorBound
+
+static inline bool isSampled(SetSample* sample, unsigned int addr) {
+	return sample->sampled[(addr >> sample->shift) & (sample->numberOfGroups - 1)];
+}
+
+static inline void countSample(SampleCounts* counts, int index, bool hit) {
+	int group = (index >> counts->shift) & counts->mask;
+
+	counts->accesses[group] += 1;
+	counts->hits[group] += hit;
+}
+
+#endif
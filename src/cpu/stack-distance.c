@@ -0,0 +1,202 @@
+/* Single-pass LRU miss-ratio curves (see stack-distance.h). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stack-distance.h"
+
+#define INITIAL_SET_CAPACITY 16
+#define INITIAL_TABLE_SIZE (1 << 12)
+#define INITIAL_HISTOGRAM_SIZE 64
+
+StackDistance* createStackDistance(int numberOfSets) {
+	StackDistance* analysis = (StackDistance *) calloc(1, sizeof(StackDistance));
+
+	analysis->sets = (StackDistanceSet *) calloc(numberOfSets, sizeof(StackDistanceSet));
+	analysis->numberOfSets = numberOfSets;
+	analysis->keys = (unsigned int *) calloc(INITIAL_TABLE_SIZE, sizeof(unsigned int));
+	analysis->times = (unsigned int *) malloc(sizeof(unsigned int) * INITIAL_TABLE_SIZE);
+	analysis->mask = INITIAL_TABLE_SIZE - 1;
+	analysis->histogram = (long long *) calloc(INITIAL_HISTOGRAM_SIZE, sizeof(long long));
+	analysis->histogramSize = INITIAL_HISTOGRAM_SIZE;
+	return analysis;
+}
+
+void freeStackDistance(StackDistance* analysis) {
+	int i;
+
+	for (i = 0; i < analysis->numberOfSets; i++) {
+		free(analysis->sets[i].tree);
+		free(analysis->sets[i].owners);
+	}
+	free(analysis->sets);
+	free(analysis->keys);
+	free(analysis->times);
+	free(analysis->histogram);
+	free(analysis);
+}
+
+static inline unsigned int hashLine(unsigned int line) {
+	return line * 2654435761u;
+}
+
+/* Returns the slot of key, claiming an empty one if it is not present. */
+static unsigned int findSlot(StackDistance* analysis, unsigned int key) {
+	unsigned int slot = hashLine(key) & analysis->mask;
+
+	while (analysis->keys[slot] != 0 && analysis->keys[slot] != key) {
+		slot = (slot + 1) & analysis->mask;
+	}
+	return slot;
+}
+
+static void growTable(StackDistance* analysis) {
+	unsigned int* keys = analysis->keys;
+	unsigned int* times = analysis->times;
+	unsigned int size = analysis->mask + 1;
+	unsigned int i;
+
+	analysis->keys = (unsigned int *) calloc(size * 2, sizeof(unsigned int));
+	analysis->times = (unsigned int *) malloc(sizeof(unsigned int) * size * 2);
+	analysis->mask = size * 2 - 1;
+	for (i = 0; i < size; i++) {
+		if (keys[i] != 0) {
+			unsigned int slot = findSlot(analysis, keys[i]);
+			analysis->keys[slot] = keys[i];
+			analysis->times[slot] = times[i];
+		}
+	}
+	free(keys);
+	free(times);
+}
+
+/* Number of marks at times 0 .. time. */
+static unsigned int countMarks(StackDistanceSet* set, unsigned int time) {
+	unsigned int count = 0;
+	unsigned int i;
+
+	for (i = time + 1; i > 0; i -= i & -i) {
+		count += set->tree[i];
+	}
+	return count;
+}
+
+static void changeMark(StackDistanceSet* set, unsigned int time, unsigned int delta) {
+	unsigned int i;
+
+	for (i = time + 1; i <= set->capacity; i += i & -i) {
+		set->tree[i] += delta;
+	}
+}
+
+/* Renumbers the lines of set to times 0 .. live - 1 in the order of their
+   last reference, growing the set so that at least half of its times are
+   free afterwards. */
+static void compactSet(StackDistance* analysis, StackDistanceSet* set) {
+	unsigned int capacity = set->capacity > 0 ? set->capacity : INITIAL_SET_CAPACITY;
+	unsigned int* owners;
+	unsigned int time = 0;
+	unsigned int i;
+
+	while (set->live * 2 > capacity) {
+		capacity *= 2;
+	}
+	owners = (unsigned int *) malloc(sizeof(unsigned int) * capacity);
+	for (i = 0; i < set->time; i++) {
+		if (set->owners[i] != STACK_NO_LINE) {
+			owners[time] = set->owners[i];
+			analysis->times[findSlot(analysis, owners[time] + 1)] = time;
+			time += 1;
+		}
+	}
+	for (i = time; i < capacity; i++) {
+		owners[i] = STACK_NO_LINE;
+	}
+
+	// a node covers the times (i - lowbit(i), i], the first live of them are marked
+	free(set->tree);
+	set->tree = (unsigned int *) malloc(sizeof(unsigned int) * (capacity + 1));
+	set->tree[0] = 0;
+	for (i = 1; i <= capacity; i++) {
+		unsigned int first = i - (i & -i);
+		set->tree[i] = time > first ? (time < i ? time : i) - first : 0;
+	}
+
+	free(set->owners);
+	set->owners = owners;
+	set->capacity = capacity;
+	set->time = time;
+}
+
+static void countDistance(StackDistance* analysis, unsigned int distance) {
+	if (distance >= analysis->histogramSize) {
+		unsigned int size = analysis->histogramSize;
+		while (size <= distance) {
+			size *= 2;
+		}
+		analysis->histogram = (long long *) realloc(analysis->histogram, sizeof(long long) * size);
+		memset(analysis->histogram + analysis->histogramSize, 0, sizeof(long long) * (size - analysis->histogramSize));
+		analysis->histogramSize = size;
+	}
+	analysis->histogram[distance] += 1;
+	if (distance > analysis->maxDistance) {
+		analysis->maxDistance = distance;
+	}
+}
+
+void recordStackReference(StackDistance* analysis, unsigned int line) {
+	StackDistanceSet* set = &analysis->sets[line & (analysis->numberOfSets - 1)];
+	unsigned int key = line + 1;
+	unsigned int slot = findSlot(analysis, key);
+
+	analysis->references += 1;
+	if (analysis->keys[slot] == key) {
+		unsigned int last = analysis->times[slot];
+		if (last + 1 == set->time) {
+			// the line is already on top of the stack of its set
+			countDistance(analysis, 0);
+			return;
+		}
+		countDistance(analysis, set->live - countMarks(set, last));
+		changeMark(set, last, (unsigned int) -1);
+		set->owners[last] = STACK_NO_LINE;
+		set->live -= 1;
+	} else {
+		analysis->keys[slot] = key;
+		analysis->count += 1;
+		analysis->coldMisses += 1;
+	}
+
+	if (set->time == set->capacity) {
+		compactSet(analysis, set);
+	}
+	changeMark(set, set->time, 1);
+	set->owners[set->time] = line;
+	analysis->times[slot] = set->time;
+	set->time += 1;
+	set->live += 1;
+
+	if (analysis->count * 2 > analysis->mask) {
+		growTable(analysis);
+	}
+}
+
+/* One row per associativity, from direct mapped up to the first one
+   where only cold misses are left. */
+void writeMissRatioCurve(FILE* file, const char* name, StackDistance* analysis, int lineSize) {
+	long long hits = 0;
+	unsigned int ways;
+
+	if (analysis->references == 0) {
+		return;
+	}
+	for (ways = 1; ways <= analysis->maxDistance + 1; ways++) {
+		long long misses;
+
+		hits += analysis->histogram[ways - 1];
+		misses = analysis->references - hits;
+		fprintf(file, "%s,%u,%lld,%lld,%0.6f\n", name, ways, (long long) ways * analysis->numberOfSets * lineSize,
+			misses, (double) misses / analysis->references);
+	}
+}
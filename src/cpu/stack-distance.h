@@ -0,0 +1,49 @@
+
+#ifndef __stack_distance__
+#define __stack_distance__
+
+#include <stdio.h>
+
+/* Mattson stack-distance analysis of the references made to one cache.
+   The stack distance of a reference is the number of distinct lines of
+   the same set used since the previous reference to its line. Under LRU
+   it hits in a cache with the same sets and line size exactly when the
+   cache has more ways than its distance, so one pass gives the miss ratio
+   of every capacity at that geometry.
+
+   Every set numbers its references by a set-local time. A Fenwick tree
+   over those times marks the last reference of every line, so the
+   distance is the number of marks after it and costs O(log n). When the
+   times run out, the marks are renumbered in order and the tree rebuilt
+   (compactSet). */
+
+typedef struct StackDistanceSet {
+	unsigned int* tree;	// Fenwick tree over the time of the last reference of each line
+	unsigned int* owners;	// line referenced at each time, STACK_NO_LINE once it has been referenced again
+	unsigned int time;
+	unsigned int capacity;
+	unsigned int live;	// lines referenced in this set so far
+} StackDistanceSet;
+
+typedef struct StackDistance {
+	StackDistanceSet* sets;
+	int numberOfSets;
+	unsigned int* keys;	// open-addressing table from line + 1 to its last set-local time
+	unsigned int* times;
+	unsigned int mask;
+	unsigned int count;
+	long long* histogram;	// references by stack distance
+	unsigned int histogramSize;
+	unsigned int maxDistance;
+	long long coldMisses;
+	long long references;
+} StackDistance;
+
+#define STACK_NO_LINE 0xffffffffu
+
+StackDistance* createStackDistance(int numberOfSets);
+void freeStackDistance(StackDistance* analysis);
+void recordStackReference(StackDistance* analysis, unsigned int line);	// line is the address >> line size, its low bits the set
+void writeMissRatioCurve(FILE* file, const char* name, StackDistance* analysis, int lineSize);
+
+#endif
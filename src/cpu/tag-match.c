@@ -0,0 +1,105 @@
+/* Tag comparison across all ways of a set.
+   The vector variants compare 4 (SSE2) or 8 (AVX2) tag words per
+   instruction; the variant is picked at runtime from the CPU features and
+   the associativity of the cache. At 8 ways AVX2 is no faster than SSE2
+   (see tag_match_bench), so it is only used from 16 ways up. */
+
+#include <stddef.h>
+
+#include "tag-match.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define TAG_MATCH_X86
+#include <immintrin.h>
+#endif
+
+int matchTagScalar(const unsigned int* tags, int numberOfWay, unsigned int key) {
+	int i;
+
+	for (i = 0; i < numberOfWay; i++) {
+		if (tags[i] == key) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+#ifdef TAG_MATCH_X86
+
+/* numberOfWay must be a multiple of 4. */
+int matchTagSSE2(const unsigned int* tags, int numberOfWay, unsigned int key) {
+	int i;
+	__m128i keys = _mm_set1_epi32((int) key);
+
+	for (i = 0; i < numberOfWay; i += 4) {
+		__m128i line = _mm_loadu_si128((const __m128i *) (tags + i));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(line, keys)));
+		if (mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return -1;
+}
+
+/* numberOfWay must be a multiple of 8. Up to 32 ways are compared without
+   a branch between the 8-way chunks. The upper register halves are cleared
+   explicitly on the way out: gcc only emits vzeroupper at -O2, and the
+   rest of spim is built at -O with legacy SSE encodings. */
+__attribute__((target("avx2")))
+int matchTagAVX2(const unsigned int* tags, int numberOfWay, unsigned int key) {
+	int i, j;
+	int way = -1;
+	__m256i keys = _mm256_set1_epi32((int) key);
+
+	for (i = 0; i < numberOfWay && way < 0; i += 32) {
+		unsigned int mask = 0;
+		int chunk = numberOfWay - i < 32 ? numberOfWay - i : 32;
+
+		for (j = 0; j < chunk; j += 8) {
+			__m256i line = _mm256_loadu_si256((const __m256i *) (tags + i + j));
+			unsigned int lane = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(line, keys)));
+			mask |= lane << j;
+		}
+		if (mask != 0) {
+			way = i + __builtin_ctz(mask);
+		}
+	}
+	_mm256_zeroupper();
+	return way;
+}
+
+TagMatchFunction selectTagMatch(int numberOfWay) {
+	if (numberOfWay >= 16 && numberOfWay % 8 == 0 && __builtin_cpu_supports("avx2")) {
+		return matchTagAVX2;
+	}
+	if (numberOfWay % 4 == 0) {
+		return matchTagSSE2;
+	}
+	return matchTagScalar;
+}
+
+#else
+
+int matchTagSSE2(const unsigned int* tags, int numberOfWay, unsigned int key) {
+	return matchTagScalar(tags, numberOfWay, key);
+}
+
+int matchTagAVX2(const unsigned int* tags, int numberOfWay, unsigned int key) {
+	return matchTagScalar(tags, numberOfWay, key);
+}
+
+TagMatchFunction selectTagMatch(int numberOfWay) {
+	(void) numberOfWay;
+	return matchTagScalar;
+}
+
+#endif
+
+const char* tagMatchName(TagMatchFunction match) {
+	if (match == matchTagAVX2) {
+		return "AVX2";
+	} else if (match == matchTagSSE2) {
+		return "SSE2";
+	}
+	return "scalar";
+}
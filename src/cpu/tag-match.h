@@ -0,0 +1,20 @@
+
+#ifndef __tag_match__
+#define __tag_match__
+
+/* A tag word holds the address tag with TAG_VALID folded into its top bit.
+   Tags are at most 30 bits wide (addresses are word aligned), so an invalid
+   line (word 0) can never match a lookup key. */
+#define TAG_VALID 0x80000000u
+
+/* Returns the way in tags[0 .. numberOfWay) equal to key, or -1. */
+typedef int (*TagMatchFunction)(const unsigned int* tags, int numberOfWay, unsigned int key);
+
+int matchTagScalar(const unsigned int* tags, int numberOfWay, unsigned int key);
+int matchTagSSE2(const unsigned int* tags, int numberOfWay, unsigned int key);
+int matchTagAVX2(const unsigned int* tags, int numberOfWay, unsigned int key);
+
+TagMatchFunction selectTagMatch(int numberOfWay);	// fastest variant this CPU supports
+const char* tagMatchName(TagMatchFunction match);
+
+#endif
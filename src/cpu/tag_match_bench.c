@@ -0,0 +1,114 @@
+/* Microbenchmark of the set lookup.
+   Compares the per-way loop with a separate valid flag (the lookup the
+   cache used before tag-match.c) against the scalar, SSE2 and AVX2 tag
+   matchers for several associativities. About half of the lookups hit.
+
+   usage: tag_match_bench [number of lookups] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tag-match.h"
+
+#define NUMBER_OF_SETS 1024
+
+static unsigned int seed = 12345;
+
+static unsigned int nextRandom() {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int matchTagWithFlags(const unsigned int* tags, const unsigned char* valid, int numberOfWay, unsigned int tag) {
+	int i;
+
+	for (i = 0; i < numberOfWay; i++) {
+		if (tags[i] == tag && valid[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int main(int argc, char** argv) {
+	int numberOfLookups = argc > 1 ? atoi(argv[1]) : 20000000;
+	int ways[] = {1, 2, 4, 8, 16, 32};
+	int w, i;
+
+	unsigned int* sets = (unsigned int *) malloc(sizeof(unsigned int) * numberOfLookups);
+	unsigned int* keys = (unsigned int *) malloc(sizeof(unsigned int) * numberOfLookups);
+
+	printf("%5s %12s %12s %12s %12s   (ns per lookup)\n", "ways", "loop+flags", "scalar", "SSE2", "AVX2");
+	for (w = 0; w < (int) (sizeof(ways) / sizeof(ways[0])); w++) {
+		int numberOfWay = ways[w];
+		int numberOfLines = NUMBER_OF_SETS * numberOfWay;
+		unsigned int* rawTags = (unsigned int *) malloc(sizeof(unsigned int) * numberOfLines);
+		unsigned char* valid = (unsigned char *) malloc(numberOfLines);
+		unsigned int* tags = (unsigned int *) malloc(sizeof(unsigned int) * numberOfLines);
+		TagMatchFunction matchers[] = {matchTagScalar, matchTagSSE2, matchTagAVX2};
+		double times[4];
+		long long sink = 0;
+		int m;
+
+		for (i = 0; i < numberOfLines; i++) {
+			rawTags[i] = nextRandom() & 0x3fffffff;
+			valid[i] = 1;
+			tags[i] = rawTags[i] | TAG_VALID;
+		}
+		for (i = 0; i < numberOfLookups; i++) {
+			unsigned int set = nextRandom() % NUMBER_OF_SETS;
+			sets[i] = set;
+			keys[i] = (nextRandom() & 1)
+				? rawTags[set * numberOfWay + nextRandom() % numberOfWay]
+				: (nextRandom() & 0x3fffffff);
+		}
+
+		double start = now();
+		for (i = 0; i < numberOfLookups; i++) {
+			int base = sets[i] * numberOfWay;
+			sink += matchTagWithFlags(rawTags + base, valid + base, numberOfWay, keys[i]);
+		}
+		times[0] = now() - start;
+
+		for (m = 0; m < 3; m++) {
+			TagMatchFunction match = matchers[m];
+			int usable = (match == matchTagScalar)
+				|| (match == matchTagSSE2 && numberOfWay % 4 == 0)
+				|| (match == matchTagAVX2 && numberOfWay % 8 == 0 && selectTagMatch(numberOfWay) == matchTagAVX2);
+
+			times[m + 1] = -1;
+			if (!usable) continue;
+
+			start = now();
+			for (i = 0; i < numberOfLookups; i++) {
+				sink += match(tags + sets[i] * numberOfWay, numberOfWay, keys[i] | TAG_VALID);
+			}
+			times[m + 1] = now() - start;
+		}
+
+		printf("%5d", numberOfWay);
+		for (m = 0; m < 4; m++) {
+			if (times[m] < 0) {
+				printf(" %12s", "-");
+			} else {
+				printf(" %12.2f", times[m] * 1e9 / numberOfLookups);
+			}
+		}
+		printf("   [%s selected] (%lld)\n", tagMatchName(selectTagMatch(numberOfWay)), sink);
+
+		free(rawTags);
+		free(valid);
+		free(tags);
+	}
+
+	free(sets);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,431 @@
+/* Timing model of the run loop (see timing.h). The stall counting below
+   was part of run_spim; it runs on the run loop's thread, or on the
+   timing thread from the records of the ring. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "spim.h"
+#include "string-stream.h"
+#include "inst.h"
+#include "reg.h"
+#include "parser_yacc.h"
+#include "cache.h"
+#include "cache-model.h"
+#include "pipeline.h"
+#include "interval-stats.h"
+#include "timing.h"
+
+#define TIMING_QUEUE_SIZE 8192	// records, a multiple of TIMING_BATCH_SIZE
+#define TIMING_BATCH_SIZE 64	// records the run loop publishes at once
+
+/* Kinds of record */
+#define TIMING_INSTRUCTION 0
+#define TIMING_BEGIN 1
+#define TIMING_END 2
+#define TIMING_STOP 3
+
+/* Flags of a record about the instruction before it, which the run loop
+   only knows once it executed */
+#define TIMING_RETIRED 0x10
+#define TIMING_REDIRECTED 0x20
+
+typedef struct TimingRecord {
+	instruction* inst;
+	unsigned int pc;
+	unsigned int addr;	// effective address of lw and sw
+	unsigned char kind;
+	unsigned char flags;	// TIMING_TIMED ... TIMING_REDIRECTED
+} TimingRecord;
+
+/* What run_spim kept in local variables for the timing. */
+typedef struct TimingModel {
+	instruction* inst;	// the last instruction and the two before it
+	instruction* inst1;
+	instruction* inst2;
+	unsigned int pc;	// of inst
+	bool timed;	// inst is timed
+	int stall;
+	bool bp;
+	int i;
+	int PB[8];
+	mem_addr BIA[9];	// a new branch is stored before i wraps around, the ninth entry takes that store
+	int n_cycle, n_dataf, n_dstall, n_bstall, n_dh;
+	bool nonblocking;
+	int reg_ready[R_LENGTH];	// cycle a non-blocking load fills each register
+} TimingModel;
+
+/* Single-producer single-consumer ring of records from the run loop to
+   the timing thread. Only the run loop writes tail, only the timing
+   thread head; each is published with release and read with acquire
+   ordering, and they sit on separate cache lines. The run loop fills
+   records ahead of tail and publishes them in batches. */
+typedef struct TimingQueue {
+	TimingRecord records[TIMING_QUEUE_SIZE];
+	unsigned int head;
+	char headPadding[CACHE_LINE_SIZE - sizeof(unsigned int)];
+	unsigned int tail;
+	unsigned int next;	// the record the run loop fills next
+	unsigned int knownHead;	// head when the run loop last read it
+	bool ready;	// the timing thread built its cache hierarchy
+	char tailPadding[CACHE_LINE_SIZE - 3 * sizeof(unsigned int) - sizeof(bool)];
+	pthread_t thread;
+} TimingQueue;
+
+static TimingModel model;	// used by the timing thread when there is one
+static bool useTimingThread = false;
+static TimingQueue* timingQueue = NULL;
+static unsigned char retiredFlags = 0;	// of the last instruction, sent with the next record
+
+void use_timing_thread() {
+	useTimingThread = true;
+}
+
+static void resetModel(TimingModel* model) {
+	memset(model, 0, sizeof(TimingModel));
+	model->bp = true;
+	model->n_cycle = pipelineModel != NULL ? pipelineModel->numberOfStages - 1 : 4;
+	model->nonblocking = nonblocking_data_cache();
+}
+
+/* The cycle at which inst can execute when earlier non-blocking loads may
+   still be filling the registers it reads. A syscall may read any
+   register (and ends the program), so it waits for all of them. */
+static int waitForLoads(instruction* inst, int* reg_ready, int cycle) {
+	int ready = cycle;
+	int i;
+
+	switch (OPCODE(inst)) {
+	case Y_J_OP:
+	case Y_JAL_OP:
+		return cycle;
+
+	case Y_SYSCALL_OP:
+		for (i = 1; i < R_LENGTH; i++) {
+			if (reg_ready[i] > ready) {
+				ready = reg_ready[i];
+			}
+		}
+		return ready;
+
+	case Y_ADDI_OP:
+	case Y_ADDIU_OP:
+	case Y_ANDI_OP:
+	case Y_ORI_OP:
+	case Y_XORI_OP:
+	case Y_SLTI_OP:
+	case Y_SLTIU_OP:
+	case Y_LUI_OP:
+	case Y_LB_OP:
+	case Y_LBU_OP:
+	case Y_LH_OP:
+	case Y_LHU_OP:
+	case Y_LW_OP:
+	case Y_LL_OP:
+	case Y_LWC1_OP:
+		// RT is written, not read
+		break;
+
+	default:
+		if (RT(inst) != 0 && reg_ready[RT(inst)] > ready) {
+			ready = reg_ready[RT(inst)];
+		}
+		break;
+	}
+
+	if (RS(inst) != 0 && reg_ready[RS(inst)] > ready) {
+		ready = reg_ready[RS(inst)];
+	}
+	return ready;
+}
+
+/* The data hazards and branch stalls of the instruction, its fetch and
+   its data reference. */
+static void timeInstruction(TimingModel* model, TimingRecord* record) {
+	instruction* inst = record->inst;
+	unsigned int pc = record->pc;
+	int flags = record->flags;
+
+	if(model->stall > 0) {model->inst2 = inst; model->inst1 = model->inst; model->stall=0;}
+	else {
+		if(flags & TIMING_AFTER_SECOND) model->inst2 = model->inst1;
+		if(flags & TIMING_AFTER_FIRST) model->inst1 = model->inst;
+	}
+
+	model->inst = inst;
+	model->pc = pc;
+	model->timed = flags & TIMING_TIMED;
+
+	if (model->timed && pipelineModel != NULL) {
+		int stalls = issue_instruction (pipelineModel, inst);
+		model->n_dstall += stalls;
+		model->n_cycle += stalls;
+	}
+	else if(model->timed){
+
+	if((REG_USES (inst) || FPR_USES (inst)) && (flags & TIMING_AFTER_FIRST) && inst != model->inst1) {
+		int stall_flag = 0;
+		if(READS_RESULT (inst, model->inst1)) {
+			if(!(HAZARD (inst) & HAZARD_BRANCH)) {
+				if(HAZARD (model->inst1) & HAZARD_LOAD) {model->stall++; model->n_dstall++; model->n_cycle++;}
+				else model->n_dataf++;
+			}
+			else if(HAZARD (model->inst1) & HAZARD_LOAD) {model->stall+=2; model->n_dstall+=2; model->n_cycle+=2; model->n_dh++; stall_flag = 2;}
+			else {model->stall++; model->n_dstall++; model->n_cycle++; stall_flag = 1;}
+		}
+		/* registers that inst1 writes again are taken from inst1 */
+		if((flags & TIMING_AFTER_SECOND) && inst != model->inst2 && ((REG_USES (inst) & REG_DEFS (model->inst2) & ~REG_DEFS (model->inst1)) || (FPR_USES (inst) & FPR_DEFS (model->inst2) & ~FPR_DEFS (model->inst1)))) {
+			if(!(HAZARD (inst) & HAZARD_BRANCH)) model->n_dataf++;
+			else if(HAZARD (model->inst2) & HAZARD_LOAD) {if(!stall_flag) {model->stall++; model->n_dstall++; model->n_cycle++;}}
+			else if(stall_flag<2) model->n_dataf++;
+		}
+	}
+
+	if(opcode_is_branch (OPCODE (inst))) {
+		bool taken = flags & TIMING_TAKEN;
+		int* PB = model->PB;
+		mem_addr* BIA = model->BIA;
+		if(model->bp) {
+		  int j;
+		  for(j = 0; j < 8; j++) {
+			  if(BIA[j] == pc) {
+				  if(taken) {
+					  if(PB[j] > 2) {
+						  if(++PB[j] > 4) PB[j] = 4;
+					  } else if(PB[j] < 3) {
+						  model->n_bstall++; model->n_cycle++;
+						  if(++PB[j] > 4) PB[j] = 4;
+					  }
+				  } else {
+					  if(PB[j] > 2) {
+						  model->n_bstall++; model->n_cycle++;
+						  if(--PB[j] < 1) PB[j] = 1;
+					  } else if(PB[j] < 3) {
+						  if(--PB[j] < 1) PB[j] = 1;
+					  }
+				  }
+				  break;
+			  }
+		  }
+		  if(j==8) {
+			BIA[model->i] = pc;
+			if(model->i==8) model->i = 0;
+			if(taken){
+				PB[model->i++] = 3;
+				model->stall++;
+				model->n_bstall++;
+				model->n_cycle++;
+			} else PB[model->i++] = 1;
+		  }
+		} else {
+			if(taken && pc + IDISP (inst) != pc + 4) {model->stall++; model->n_bstall++; model->n_cycle++;}
+		}
+	}
+
+	if(OPCODE (inst) == Y_JR_OP || OPCODE (inst) == Y_JALR_OP) {
+		model->stall++;
+		model->n_bstall++;
+		model->n_cycle++;
+	}
+
+	if(OPCODE (inst) == Y_J_OP || OPCODE (inst) == Y_JAL_OP) {
+		model->stall++;
+		model->n_bstall++;
+		model->n_cycle++;
+	}
+	}
+
+	// after the issue, an instruction that joined a group takes no fetch cycle of its own
+	if (model->timed && pipelineModel != NULL && pipelineModel->paired) {model->n_cycle += paired_instruction_load(pc);}
+	else {model->n_cycle += instruction_load(pc);}
+	if (model->nonblocking) {model->n_cycle = waitForLoads (inst, model->reg_ready, model->n_cycle);}
+	if (OPCODE (inst) == Y_LW_OP && model->nonblocking) {model->n_cycle += data_load_nonblocking(record->addr, pc, model->n_cycle, &model->reg_ready[RT (inst)]);}
+	else if (OPCODE (inst) == Y_LW_OP) {model->n_cycle += data_load(record->addr, pc);}
+	if (OPCODE (inst) == Y_SW_OP)	{model->n_cycle += data_store(record->addr, pc);}
+	if (intervalStats != NULL) countIntervalInstruction (intervalStats, model->n_cycle, model->n_dstall, model->n_bstall);
+}
+
+/* The cycle of the instruction, unless it issued together with the one
+   before it, and the bubbles of the pipeline model when it jumps or
+   branches. */
+static void retireInstruction(TimingModel* model, bool redirected) {
+	if (!model->timed) {
+		return;
+	}
+	if (pipelineModel == NULL || !pipelineModel->paired) {
+		model->n_cycle++;
+	}
+	if (pipelineModel != NULL) {
+		int bubbles = resolve_branch(pipelineModel, model->inst, model->pc, redirected);
+		model->n_bstall += bubbles;
+		model->n_cycle += bubbles;
+	}
+}
+
+static void printTiming(TimingModel* model) {
+	model->n_cycle++;
+	print_result(model->n_cycle, model->n_dstall, model->n_bstall);
+	if (pipelineModel != NULL) {
+		print_pipeline_result(pipelineModel, model->n_cycle);
+	}
+	print_cache_result(model->n_cycle);
+}
+
+static void* runTimingThread(void* arg) {
+	TimingQueue* queue = (TimingQueue *) arg;
+	unsigned int head = 0;
+
+	nonblocking_data_cache();	// builds the hierarchy of this thread
+	__atomic_store_n(&queue->ready, true, __ATOMIC_RELEASE);
+	for (;;) {
+		unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+		if (tail == head) {
+			sched_yield();
+			continue;
+		}
+		for (; head != tail; head++) {
+			TimingRecord* record = &queue->records[head % TIMING_QUEUE_SIZE];
+
+			if (record->flags & TIMING_RETIRED) {
+				retireInstruction(&model, record->flags & TIMING_REDIRECTED);
+			}
+			switch (record->kind) {
+			case TIMING_INSTRUCTION:
+				timeInstruction(&model, record);
+				break;
+			case TIMING_BEGIN:
+				resetModel(&model);
+				break;
+			case TIMING_END:
+				printTiming(&model);
+				break;
+			case TIMING_STOP:
+				// the interval statistics read the hierarchy of this thread
+				close_interval_stats();
+				__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+				return NULL;
+			}
+		}
+		__atomic_store_n(&queue->head, head, __ATOMIC_RELEASE);
+	}
+}
+
+static void publishRecords(TimingQueue* queue) {
+	__atomic_store_n(&queue->tail, queue->next, __ATOMIC_RELEASE);
+}
+
+/* The next record to fill; waits while the ring is full. */
+static TimingRecord* nextRecord(TimingQueue* queue, unsigned char kind) {
+	unsigned int next = queue->next;
+	TimingRecord* record;
+
+	if (next - queue->knownHead == TIMING_QUEUE_SIZE) {
+		publishRecords(queue);
+		while (next - (queue->knownHead = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) == TIMING_QUEUE_SIZE) {
+			sched_yield();
+		}
+	}
+	record = &queue->records[next % TIMING_QUEUE_SIZE];
+	record->kind = kind;
+	record->flags = retiredFlags;
+	retiredFlags = 0;
+	queue->next = next + 1;
+	return record;
+}
+
+/* Publishes everything and waits until the timing thread took it. */
+static void drainRecords(TimingQueue* queue) {
+	publishRecords(queue);
+	while (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) != queue->next) {
+		sched_yield();
+	}
+	queue->knownHead = queue->next;
+}
+
+/* At exit, after the last run: the timing thread writes the last
+   interval, unless it is the one exiting. */
+static void stopTimingThread() {
+	TimingQueue* queue = timingQueue;
+
+	if (queue == NULL || pthread_equal(pthread_self(), queue->thread)) {
+		return;
+	}
+	nextRecord(queue, TIMING_STOP);
+	publishRecords(queue);
+	pthread_join(queue->thread, NULL);
+	timingQueue = NULL;
+	free(queue);
+}
+
+/* The timing thread builds its cache hierarchy first, so that the run
+   stops on a bad configuration before the program runs, as it does
+   without the thread. */
+static void startTimingThread() {
+	TimingQueue* queue;
+
+	if (posix_memalign((void **) &queue, CACHE_LINE_SIZE, sizeof(TimingQueue)) != 0) {
+		printf("Cannot allocate the timing queue\n");
+		exit(1);
+	}
+	memset(queue, 0, sizeof(TimingQueue));
+	if (pthread_create(&queue->thread, NULL, runTimingThread, queue) != 0) {
+		printf("Cannot start the timing thread\n");
+		exit(1);
+	}
+	while (!__atomic_load_n(&queue->ready, __ATOMIC_ACQUIRE)) {
+		sched_yield();
+	}
+	timingQueue = queue;
+	atexit(stopTimingThread);
+}
+
+void begin_timing() {
+	if (useTimingThread && timingQueue == NULL) {
+		startTimingThread();
+	}
+	if (timingQueue != NULL) {
+		nextRecord(timingQueue, TIMING_BEGIN);
+		publishRecords(timingQueue);
+	} else {
+		resetModel(&model);
+	}
+}
+
+void time_instruction(unsigned int pc, struct inst_s* inst, unsigned int addr, int flags) {
+	TimingRecord local;
+	TimingRecord* record = timingQueue != NULL ? nextRecord(timingQueue, TIMING_INSTRUCTION) : &local;
+
+	record->inst = inst;
+	record->pc = pc;
+	record->addr = addr;
+	if (timingQueue != NULL) {
+		record->flags |= flags;
+		if (timingQueue->next % TIMING_BATCH_SIZE == 0) {
+			publishRecords(timingQueue);
+		}
+	} else {
+		record->flags = flags;
+		timeInstruction(&model, record);
+	}
+}
+
+void retire_instruction(bool redirected) {
+	if (timingQueue != NULL) {
+		retiredFlags = TIMING_RETIRED | (redirected ? TIMING_REDIRECTED : 0);
+	} else {
+		retireInstruction(&model, redirected);
+	}
+}
+
+void end_timing() {
+	if (timingQueue != NULL) {
+		nextRecord(timingQueue, TIMING_END);
+		drainRecords(timingQueue);
+	} else {
+		printTiming(&model);
+	}
+}
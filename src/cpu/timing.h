@@ -0,0 +1,33 @@
+
+#ifndef __timing__
+#define __timing__
+
+/* Timing model of the run loop: the fetch, data hazard, branch and cache
+   stalls of every instruction, with the fixed five stages or the pipeline
+   of spim -pipeline, and the interval statistics. run_spim only executes
+   the program and describes every instruction to the model before it
+   executes (time_instruction) and after (retire_instruction).
+
+   With spim -timing_thread the model runs on a thread of its own. The run
+   loop appends a record per instruction to a single-producer
+   single-consumer ring and goes on; the timing thread takes the records
+   in order, so the cycles and statistics are the same as without it. The
+   run loop waits when the ring is full, and at exit until the results are
+   printed. The cache hierarchy is built on the thread that times. */
+
+/* What the run loop knows of an instruction before it executes */
+#define TIMING_TIMED 0x1	// after the jal to main, the startup code is not timed
+#define TIMING_TAKEN 0x2	// a conditional branch whose condition holds
+#define TIMING_AFTER_FIRST 0x4	// not the first step of the run_spim loop
+#define TIMING_AFTER_SECOND 0x8	// neither the first nor the second step
+
+struct inst_s;
+
+/* Exported functions for the timing model */
+void use_timing_thread();	// time on a thread of its own from the next run on
+void begin_timing();		// run_spim starts, the counts start over
+void time_instruction(unsigned int pc, struct inst_s* inst, unsigned int addr, int flags);	// fetched, addr is the effective address of lw and sw
+void retire_instruction(bool redirected);	// executed, redirected when the next PC is not pc + 4
+void end_timing();		// the program exits, print the results
+
+#endif
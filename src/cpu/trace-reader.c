@@ -0,0 +1,212 @@
+/* Reads a trace written by trace-writer.c back one chunk at a time.
+   The file is mapped rather than read, so an uncompressed chunk is decoded
+   straight from the page cache. A compressed chunk is inflated into one
+   reusable chunk buffer, so nothing but the current chunk is ever held
+   decompressed. The mapping is read front to back (MADV_SEQUENTIAL) and
+   the pages already decoded are dropped every TRACE_RELEASE_SIZE bytes,
+   which keeps the resident size flat on traces larger than memory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef TRACE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef TRACE_LZ4
+#include <lz4.h>
+#endif
+
+#include "trace.h"
+
+// every record takes at least one byte
+#define MAX_RECORDS_PER_CHUNK TRACE_CHUNK_SIZE
+
+#define TRACE_RELEASE_SIZE (64 << 20)
+
+static void traceError(TraceReader* reader, const char* message) {
+	printf("%s: %s\n", reader->path, message);
+	exit(1);
+}
+
+static void createTraceBatch(TraceReader* reader) {
+	TraceBatch* batch = &reader->batch;
+
+	// zero padding stops a record that runs past a corrupt chunk
+	reader->buffer = (unsigned char *) calloc(TRACE_CHUNK_SIZE + TRACE_MAX_RECORD_SIZE, 1);
+	batch->kinds = (unsigned char *) malloc(MAX_RECORDS_PER_CHUNK);
+	batch->sizes = (unsigned char *) malloc(MAX_RECORDS_PER_CHUNK);
+	batch->pcs = (unsigned int *) malloc(sizeof(unsigned int) * MAX_RECORDS_PER_CHUNK);
+	batch->addrs = (unsigned int *) malloc(sizeof(unsigned int) * MAX_RECORDS_PER_CHUNK);
+}
+
+TraceReader* openTraceReader(const char* path) {
+	TraceFileHeader header;
+	struct stat status;
+	TraceReader* reader = (TraceReader *) calloc(1, sizeof(TraceReader));
+	int fd = open(path, O_RDONLY);
+
+	reader->path = path;
+	if (fd < 0 || fstat(fd, &status) != 0) {
+		traceError(reader, "cannot open the trace");
+	}
+	if ((size_t) status.st_size < sizeof(header)) {
+		traceError(reader, "not a trace file");
+	}
+	reader->mapSize = status.st_size;
+	reader->map = (const unsigned char *) mmap(NULL, reader->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (reader->map == MAP_FAILED) {
+		traceError(reader, "cannot map the trace");
+	}
+	madvise((void *) reader->map, reader->mapSize, MADV_SEQUENTIAL);
+
+	memcpy(&header, reader->map, sizeof(header));
+	if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+		traceError(reader, "not a trace file");
+	}
+	if (header.version != TRACE_VERSION) {
+		traceError(reader, "unsupported trace version");
+	}
+	reader->offset = sizeof(header);
+	createTraceBatch(reader);
+
+	return reader;
+}
+
+TraceReader* openTraceView(TraceReader* source) {
+	TraceReader* reader = (TraceReader *) calloc(1, sizeof(TraceReader));
+
+	reader->path = source->path;
+	reader->map = source->map;
+	reader->mapSize = source->mapSize;
+	reader->offset = sizeof(TraceFileHeader);
+	reader->view = true;
+	createTraceBatch(reader);
+
+	return reader;
+}
+
+static const char* traceCodecName(unsigned int codec) {
+	switch (codec) {
+	case TRACE_CODEC_NONE: return "no codec";
+	case TRACE_CODEC_ZSTD: return "zstd";
+	case TRACE_CODEC_LZ4: return "lz4";
+	}
+	return "an unknown codec";
+}
+
+/* Returns the raw records of the chunk stored at stored, inflating it
+   into the chunk buffer if it is compressed. */
+static const unsigned char* chunkRecords(TraceReader* reader, TraceChunkHeader* header, const unsigned char* stored) {
+	const unsigned char* mapEnd = reader->map + reader->mapSize;
+
+	switch (header->codec) {
+	case TRACE_CODEC_NONE:
+		if (header->storedSize != header->rawSize) {
+			traceError(reader, "corrupt chunk header");
+		}
+		if (stored + header->rawSize + TRACE_MAX_RECORD_SIZE <= mapEnd) {
+			return stored;
+		}
+		// the last chunk is copied so that decoding cannot run off the mapping
+		memcpy(reader->buffer, stored, header->rawSize);
+		break;
+#ifdef TRACE_ZSTD
+	case TRACE_CODEC_ZSTD:
+		if (ZSTD_decompress(reader->buffer, TRACE_CHUNK_SIZE, stored, header->storedSize) != header->rawSize) {
+			traceError(reader, "corrupt zstd chunk");
+		}
+		break;
+#endif
+#ifdef TRACE_LZ4
+	case TRACE_CODEC_LZ4:
+		if (LZ4_decompress_safe((const char *) stored, (char *) reader->buffer, header->storedSize, TRACE_CHUNK_SIZE) != (int) header->rawSize) {
+			traceError(reader, "corrupt lz4 chunk");
+		}
+		break;
+#endif
+	default:
+		printf("%s: chunk compressed with %s, which this build cannot read\n", reader->path, traceCodecName(header->codec));
+		exit(1);
+	}
+
+	memset(reader->buffer + header->rawSize, 0, TRACE_MAX_RECORD_SIZE);
+	return reader->buffer;
+}
+
+int readTraceBatch(TraceReader* reader) {
+	TraceChunkHeader header;
+	TraceBatch* batch = &reader->batch;
+	const unsigned char* in;
+	const unsigned char* end;
+	unsigned int lastPC = 0;
+	unsigned int lastAddr = 0;
+	unsigned int i;
+
+	batch->count = 0;
+	if (reader->offset == reader->mapSize) {
+		return 0;
+	}
+	if (reader->mapSize - reader->offset < sizeof(header)) {
+		traceError(reader, "truncated chunk");
+	}
+	memcpy(&header, reader->map + reader->offset, sizeof(header));
+	reader->offset += sizeof(header);
+	if (header.rawSize > TRACE_CHUNK_SIZE || header.records > header.rawSize) {
+		traceError(reader, "corrupt chunk header");
+	}
+	if (header.storedSize > reader->mapSize - reader->offset) {
+		traceError(reader, "truncated chunk");
+	}
+
+	in = chunkRecords(reader, &header, reader->map + reader->offset);
+	end = in + header.rawSize;
+	reader->offset += header.storedSize;
+
+	for (i = 0; i < header.records && in < end; i++) {
+		unsigned char record = *in++;
+		unsigned int kind = record & TRACE_KIND_MASK;
+		unsigned int pc = lastPC + ((kind == TRACE_INST) << 2);
+
+		if (!(record & TRACE_PREDICTED_PC)) {
+			pc += getTraceVarint(&in);
+		}
+		if (kind != TRACE_INST) {
+			lastAddr += getTraceVarint(&in);
+		}
+		batch->addrs[i] = kind != TRACE_INST ? lastAddr : pc;
+		batch->kinds[i] = (unsigned char) kind;
+		batch->sizes[i] = (unsigned char) (1 << (record >> TRACE_SIZE_SHIFT & 0x3));
+		batch->pcs[i] = pc;
+		lastPC = pc;
+	}
+	if (i != header.records || in != end) {
+		traceError(reader, "corrupt chunk");
+	}
+
+	if (!reader->view && reader->offset - reader->released >= TRACE_RELEASE_SIZE) {
+		size_t release = (reader->offset & ~(size_t) (sysconf(_SC_PAGESIZE) - 1)) - reader->released;
+		madvise((void *) (reader->map + reader->released), release, MADV_DONTNEED);
+		reader->released += release;
+	}
+
+	batch->count = header.records;
+	return batch->count;
+}
+
+void closeTraceReader(TraceReader* reader) {
+	if (!reader->view) {
+		munmap((void *) reader->map, reader->mapSize);
+	}
+	free(reader->buffer);
+	free(reader->batch.kinds);
+	free(reader->batch.sizes);
+	free(reader->batch.pcs);
+	free(reader->batch.addrs);
+	free(reader);
+}
@@ -0,0 +1,106 @@
+/* Trace capture (see trace.h for the format). The run loop encodes every
+   reference into the chunk buffer of traceWriter; this file only writes
+   the chunks out, compressed when a codec was built in. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(TRACE_ZSTD)
+#include <zstd.h>
+#elif defined(TRACE_LZ4)
+#include <lz4.h>
+#endif
+
+#include "trace.h"
+
+TraceWriter* traceWriter = NULL;
+
+/* Compresses the chunk into writer->packed and returns its size, or 0 to
+   store the chunk raw. */
+static unsigned int packChunk(TraceWriter* writer, TraceChunkHeader* header) {
+#if defined(TRACE_ZSTD)
+	size_t size = ZSTD_compress(writer->packed, writer->packedCapacity, writer->buffer, writer->used, 1);
+	if (ZSTD_isError(size)) {
+		return 0;
+	}
+	header->codec = TRACE_CODEC_ZSTD;
+	return size;
+#elif defined(TRACE_LZ4)
+	header->codec = TRACE_CODEC_LZ4;
+	return LZ4_compress_default((const char *) writer->buffer, (char *) writer->packed, writer->used, writer->packedCapacity);
+#else
+	(void) writer;
+	(void) header;
+	return 0;
+#endif
+}
+
+void flushTraceChunk(TraceWriter* writer) {
+	TraceChunkHeader header;
+	unsigned char* stored = writer->packed;
+
+	if (writer->records == 0) {
+		return;
+	}
+	header.records = writer->records;
+	header.rawSize = writer->used;
+	header.storedSize = packChunk(writer, &header);
+	if (header.storedSize == 0 || header.storedSize >= writer->used) {
+		stored = writer->buffer;
+		header.storedSize = writer->used;
+		header.codec = TRACE_CODEC_NONE;
+	}
+	if (fwrite(&header, sizeof(header), 1, writer->file) != 1
+		|| fwrite(stored, 1, header.storedSize, writer->file) != header.storedSize) {
+		printf("Cannot write the trace\n");
+		exit(1);
+	}
+
+	writer->used = 0;
+	writer->records = 0;
+	writer->lastPC = 0;
+	writer->lastAddr = 0;
+}
+
+void open_trace_capture(char* path) {
+	TraceFileHeader header;
+	TraceWriter* writer = (TraceWriter *) calloc(1, sizeof(TraceWriter));
+
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL) {
+		printf("Cannot open the trace file %s\n", path);
+		exit(1);
+	}
+	writer->buffer = (unsigned char *) malloc(TRACE_CHUNK_SIZE);
+#if defined(TRACE_ZSTD)
+	writer->packedCapacity = ZSTD_compressBound(TRACE_CHUNK_SIZE);
+#elif defined(TRACE_LZ4)
+	writer->packedCapacity = LZ4_compressBound(TRACE_CHUNK_SIZE);
+#endif
+	if (writer->packedCapacity != 0) {
+		writer->packed = (unsigned char *) malloc(writer->packedCapacity);
+	}
+
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.flags = 0;
+	fwrite(&header, sizeof(header), 1, writer->file);
+
+	traceWriter = writer;
+	atexit(close_trace_capture);
+}
+
+void close_trace_capture() {
+	TraceWriter* writer = traceWriter;
+
+	if (writer == NULL) {
+		return;
+	}
+	flushTraceChunk(writer);
+	fclose(writer->file);
+	free(writer->buffer);
+	free(writer->packed);
+	free(writer);
+	traceWriter = NULL;
+}
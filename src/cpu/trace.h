@@ -0,0 +1,171 @@
+
+#ifndef __trace__
+#define __trace__
+
+#include <stdio.h>
+
+/* Binary trace of the references the pipeline makes to the cache.
+
+   A trace file starts with a TraceFileHeader, followed by chunks. Every
+   chunk is a TraceChunkHeader and storedSize bytes of records, which are
+   rawSize bytes once decompressed (codec). The delta state is reset at
+   the start of every chunk, so chunks decode independently.
+
+   Chunks are compressed with zstd or lz4 when the simulator is built with
+   TRACE_ZSTD or TRACE_LZ4 (see the Makefile); a chunk that does not
+   shrink is stored raw. A reader built without the codec rejects such a
+   trace.
+
+   A record is one header byte
+
+     bits 0-1  kind (TraceKind)
+     bits 2-3  log2 of the access size in bytes
+     bit 4     TRACE_PREDICTED_PC: the pc is the predicted one and omitted
+
+   followed by the pc, unless predicted, and for loads and stores the
+   address. Both are stored as the zigzag LEB128 varint of their
+   difference to the predicted pc (last pc + 4 for an instruction, the
+   last pc for a load or store) and to the last data address. The address
+   of an instruction fetch is its pc. A sequential fetch is one byte, a
+   load or store usually two or three. */
+
+#define TRACE_MAGIC "SPTR"
+#define TRACE_VERSION 1
+
+#define TRACE_CHUNK_SIZE (64 * 1024)	// raw bytes of records per chunk at most
+#define TRACE_MAX_RECORD_SIZE 11	// header byte and two 5-byte varints
+
+#define TRACE_KIND_MASK 0x3
+#define TRACE_SIZE_SHIFT 2
+#define TRACE_PREDICTED_PC 0x10
+
+typedef enum TraceKind {
+	TRACE_INST, TRACE_LOAD, TRACE_STORE,
+} TraceKind;
+
+typedef enum TraceCodec {
+	TRACE_CODEC_NONE, TRACE_CODEC_ZSTD, TRACE_CODEC_LZ4,
+} TraceCodec;
+
+typedef struct TraceFileHeader {
+	char magic[4];
+	unsigned short version;
+	unsigned short flags;
+} TraceFileHeader;
+
+typedef struct TraceChunkHeader {
+	unsigned int records;
+	unsigned int rawSize;
+	unsigned int storedSize;
+	unsigned int codec;
+} TraceChunkHeader;
+
+/* Trace being written. Records are encoded into buffer, which is written
+   out as one chunk when it cannot take another record; packed holds the
+   compressed chunk. */
+typedef struct TraceWriter {
+	FILE* file;
+	unsigned char* buffer;
+	unsigned char* packed;
+	unsigned int packedCapacity;
+	unsigned int used;
+	unsigned int records;
+	unsigned int lastPC;
+	unsigned int lastAddr;
+} TraceWriter;
+
+/* Records of one chunk, decoded into parallel arrays. */
+typedef struct TraceBatch {
+	int count;
+	unsigned char* kinds;
+	unsigned char* sizes;
+	unsigned int* pcs;
+	unsigned int* addrs;
+} TraceBatch;
+
+/* Trace being read. The whole file is mapped at map; offset is the next
+   chunk header and the pages before released have been given back.
+   buffer receives a chunk that cannot be decoded in place. A view reads
+   the mapping of another reader, so it neither releases nor unmaps it. */
+typedef struct TraceReader {
+	const char* path;
+	const unsigned char* map;
+	size_t mapSize;
+	size_t offset;
+	size_t released;
+	bool view;
+	unsigned char* buffer;
+	TraceBatch batch;
+} TraceReader;
+
+TraceReader* openTraceReader(const char* path);
+TraceReader* openTraceView(TraceReader* source);	// reads the trace of source again, from the start
+int readTraceBatch(TraceReader* reader);	// decodes the next chunk into reader->batch, 0 at the end
+void closeTraceReader(TraceReader* reader);
+
+/* Exported functions for trace capture */
+void open_trace_capture(char* path);	// record every cache reference into path
+void close_trace_capture();		// flush and close the trace, if any
+
+extern TraceWriter* traceWriter;
+
+void flushTraceChunk(TraceWriter* writer);
+
+static inline unsigned char* putTraceVarint(unsigned char* out, int delta) {
+	unsigned int value = ((unsigned int) delta << 1) ^ (unsigned int) (delta >> 31);
+
+	while (value >= 0x80) {
+		*out++ = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (unsigned char) value;
+	return out;
+}
+
+static inline int getTraceVarint(const unsigned char** in) {
+	const unsigned char* p = *in;
+	unsigned int value = *p++;
+
+	// most deltas fit in one byte
+	if (value & 0x80) {
+		int shift = 7;
+		value &= 0x7f;
+		while ((*p & 0x80) && shift < 28) {
+			value |= (unsigned int) (*p++ & 0x7f) << shift;
+			shift += 7;
+		}
+		value |= (unsigned int) *p++ << shift;
+	}
+	*in = p;
+	return (int) (value >> 1) ^ -(int) (value & 1);
+}
+
+static inline int traceSizeCode(int size) {
+	return size >= 4 ? (size >= 8 ? 3 : 2) : size - 1;
+}
+
+static inline void writeTraceRecord(TraceWriter* writer, TraceKind kind, unsigned int pc, unsigned int addr, int size) {
+	unsigned char* out = writer->buffer + writer->used;
+	unsigned int predicted = kind == TRACE_INST ? writer->lastPC + 4 : writer->lastPC;
+	unsigned char header = (unsigned char) (kind | (traceSizeCode(size) << TRACE_SIZE_SHIFT));
+
+	if (pc == predicted) {
+		*out++ = header | TRACE_PREDICTED_PC;
+	} else {
+		*out++ = header;
+		out = putTraceVarint(out, (int) (pc - predicted));
+	}
+	if (kind != TRACE_INST) {
+		out = putTraceVarint(out, (int) (addr - writer->lastAddr));
+		writer->lastAddr = addr;
+	}
+	writer->lastPC = pc;
+	writer->used = out - writer->buffer;
+	writer->records += 1;
+
+	if (writer->used > TRACE_CHUNK_SIZE - TRACE_MAX_RECORD_SIZE) {
+		flushTraceChunk(writer);
+	}
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* Write buffer of a write-through cache. Entries drain in order, so the
+   buffer is a ring and an entry is gone once its drain cycle has passed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "write-buffer.h"
+
+WriteBuffer* createWriteBuffer(int capacity) {
+	WriteBuffer* buffer = (WriteBuffer *) calloc(1, sizeof(WriteBuffer));
+
+	buffer->capacity = capacity;
+	buffer->entries = (BufferedWrite *) calloc(capacity, sizeof(BufferedWrite));
+
+	return buffer;
+}
+
+void freeWriteBuffer(WriteBuffer* buffer) {
+	free(buffer->entries);
+	free(buffer);
+}
+
+static void retireWrites(WriteBuffer* buffer, long long now) {
+	while (buffer->count > 0 && buffer->entries[buffer->head].drainCycle <= now) {
+		buffer->head = (buffer->head + 1) % buffer->capacity;
+		buffer->count -= 1;
+	}
+}
+
+/* True when a store to line at cycle now merges into a queued entry. The
+   entry being written at the moment cannot take it any more. */
+bool coalesceWrite(WriteBuffer* buffer, unsigned int line, long long now) {
+	int i;
+
+	retireWrites(buffer, now);
+	buffer->stats.writes += 1;
+	for (i = 1; i < buffer->count; i++) {
+		if (buffer->entries[(buffer->head + i) % buffer->capacity].line == line) {
+			buffer->stats.coalesced += 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Queues a store to line at cycle now whose write to the next level takes
+   drainTime cycles, and returns the cycles the store stalls because the
+   buffer is full. Call coalesceWrite first. */
+int bufferWrite(WriteBuffer* buffer, unsigned int line, int drainTime, long long now) {
+	int stallCycles = 0;
+	long long start = now;
+	BufferedWrite* entry;
+
+	if (buffer->count == buffer->capacity) {
+		BufferedWrite* oldest = &buffer->entries[buffer->head];
+		stallCycles = (int) (oldest->drainCycle - now);
+		buffer->stats.fullStalls += 1;
+		buffer->stats.fullStallCycles += stallCycles;
+		retireWrites(buffer, oldest->drainCycle);
+		start = now + stallCycles;
+	}
+
+	if (buffer->count > 0) {
+		long long last = buffer->entries[(buffer->head + buffer->count - 1) % buffer->capacity].drainCycle;
+		if (last > start) {
+			start = last;
+		}
+	}
+	entry = &buffer->entries[(buffer->head + buffer->count) % buffer->capacity];
+	entry->line = line;
+	entry->drainCycle = start + drainTime;
+	buffer->count += 1;
+	if (buffer->count > buffer->stats.peakOccupancy) {
+		buffer->stats.peakOccupancy = buffer->count;
+	}
+
+	return stallCycles;
+}
+
+void printWriteBufferStats(const char* name, WriteBuffer* buffer) {
+	WriteBufferStats* stats = &buffer->stats;
+
+	printf("Write buffer of %s (%d entries)\n", name, buffer->capacity);
+	printf("Writes: %lld, Coalesced: %lld (%0.3f), Peak Occupancy: %d\n", stats->writes, stats->coalesced,
+		stats->writes ? (float) stats->coalesced / stats->writes : 0.0, stats->peakOccupancy);
+	printf("Full Stalls: %lld (%lld cycles)\n", stats->fullStalls, stats->fullStallCycles);
+}
@@ -0,0 +1,39 @@
+
+#ifndef __write_buffer__
+#define __write_buffer__
+
+/* Write buffer between a write-through cache and the level below.
+   Stores are queued by line and drain to the next level one after the
+   other whenever it is idle; each drain takes as long as the write it
+   replaces would have stalled. A store only stalls when the buffer is
+   full, until the oldest entry has drained. A store to a line that is
+   still queued is merged into its entry (write combining). */
+
+typedef struct BufferedWrite {
+	unsigned int line;
+	long long drainCycle;
+} BufferedWrite;
+
+typedef struct WriteBufferStats {
+	long long writes;
+	long long coalesced;
+	long long fullStalls;
+	long long fullStallCycles;
+	int peakOccupancy;
+} WriteBufferStats;
+
+typedef struct WriteBuffer {
+	int capacity;
+	BufferedWrite* entries;	// ring of count entries starting at head, oldest first
+	int head;
+	int count;
+	WriteBufferStats stats;
+} WriteBuffer;
+
+WriteBuffer* createWriteBuffer(int capacity);
+void freeWriteBuffer(WriteBuffer* buffer);
+bool coalesceWrite(WriteBuffer* buffer, unsigned int line, long long now);
+int bufferWrite(WriteBuffer* buffer, unsigned int line, int drainTime, long long now);	// stall cycles
+void printWriteBufferStats(const char* name, WriteBuffer* buffer);
+
+#endif
@@ -0,0 +1,27 @@
+# LRU order of a non-blocking L1 data cache. Run with ../CPU/cache.config
+#
+#	2 400
+#	16 1 2 LRU WB 0 MSHR 2
+#	1024 8 4 LRU WB 10
+#
+# A, B and C share the one set of the 2-way L1. The lw of C has to evict
+# A, which was used last before the lw of B, so the lw of A hits:
+# l1d 4 hits, 3 misses.
+
+.data 0x10000000
+	.word	1, 2, 3
+
+.text
+main:
+	lui	$t0, 0x1000	# A
+	addi	$t1, $t0, 0x100	# B
+	addi	$t2, $t0, 0x200	# C
+	sw	$zero, 0($t0)	# A miss
+	sw	$zero, 0($t1)	# B miss
+	sw	$zero, 0($t0)	# A hit
+	lw	$t3, 0($t1)	# B hit
+	sw	$zero, 0($t0)	# A hit
+	lw	$t3, 0($t2)	# C miss, evicts B
+	lw	$t3, 0($t0)	# A hit
+	addi	$v0, $zero, 10
+	syscall			# exit()